@@ -0,0 +1,251 @@
+// Benchmarks for the camera frame kernels in src/imageKernels.cpp, run
+// without a window or a camera:
+//
+//   g++ -O2 -std=c++11 -Isrc -o image_bench bench/image_bench.cpp
+//       src/imageKernels.cpp
+//
+// Add -fopenmp to allow the row bands to run on several threads.
+//
+// Usage: image_bench [width] [height] [min_time]
+//
+// Each kernel runs on a random frame of the given size (default 1280x720)
+// until min_time seconds (default 0.5) have elapsed. Before that, every
+// kernel is checked against the plain C++ version on a range of frame
+// widths, including ones that are not a multiple of the SIMD width, and the
+// exit status is nonzero if any of them differ. The results are written to
+// standard output as CSV with the columns
+//
+//   kernel,isa,width,height,threads,frames,us_per_frame,gb_per_s,frame_pct
+//
+// where gb_per_s counts the bytes read from the camera frame and written to
+// the result, and frame_pct is the share of a 60 Hz frame that the kernel
+// takes. The mirror_copy_gray baseline also makes the two intermediate
+// copies that the capture path made before mirror_gray replaced it, and
+// motion_separate does the motion detection as separate passes, as
+// ofApp::updateContourBlobs() did before motion_fused replaced it. The
+// motion_fused_half and motion_fused_quarter cases shrink the grey image
+// by two and four, which leaves only the frame to be read at full size.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <chrono>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "imageKernels.h"
+
+typedef std::chrono::steady_clock bench_clock;
+
+/** The mirror loop that ofApp::mirrorCam() used before the kernels, kept as
+ * the baseline. */
+void mirror_original(const unsigned char *pixels,unsigned char *camMirror,int camWidth,int camHeight) {
+	for (int i = 0; i < camHeight; i++) {
+		for (int j = 0; j < camWidth * 3; j += 3) {
+			int pix1 = (i*camWidth * 3) + j;
+			int pix2 = (i*camWidth * 3) + (j + 1);
+			int pix3 = (i*camWidth * 3) + (j + 2);
+			int mir1 = (i*camWidth * 3) + 1 * (camWidth * 3 - j - 3);
+			int mir2 = (i*camWidth * 3) + 1 * (camWidth * 3 - j - 2);
+			int mir3 = (i*camWidth * 3) + 1 * (camWidth * 3 - j - 1);
+			camMirror[pix1] = pixels[mir1];
+			camMirror[pix2] = pixels[mir2];
+			camMirror[pix3] = pixels[mir3];
+		}
+	}
+}
+
+/** Fills a buffer with deterministic random bytes. */
+void random_bytes(std::vector<unsigned char> &v,unsigned long long s) {
+	for(size_t i=0;i<v.size();i++) {
+		s^=s<<13;s^=s>>7;s^=s<<17;
+		v[i]=(unsigned char) (s>>32);
+	}
+}
+
+/** Returns the number of seconds since a time point. */
+inline double seconds_since(bench_clock::time_point t0) {
+	return std::chrono::duration<double>(bench_clock::now()-t0).count();
+}
+
+/** The kernels that are benchmarked, all with the same signature. */
+struct bench_kernel {
+	const char *name;
+	int threads;
+	void (*run)(const unsigned char*,unsigned char*,int,int,int);
+	/** The number of bytes read and written per pixel. */
+	int bytes_per_pixel;
+};
+
+void run_mirror_original(const unsigned char *s,unsigned char *d,int w,int h,int) {mirror_original(s,d,w,h);}
+void run_mirror_scalar(const unsigned char *s,unsigned char *d,int w,int h,int) {mirrorRgbScalar(s,d,w,h);}
+void run_mirror(const unsigned char *s,unsigned char *d,int w,int h,int t) {mirrorRgb(s,d,w,h,t);}
+
+/** The grey conversion of cvCvtColor() with CV_RGB2GRAY. */
+void gray_original(const unsigned char *s,unsigned char *d,int w,int h) {
+	for(int k=0;k<w*h;k++,s+=3) d[k]=(unsigned char) ((s[0]*4899+s[1]*9617+s[2]*1868+(1<<13))>>14);
+}
+
+/** The capture path before the mirroring was folded into the grey
+ * conversion: mirror into a buffer, copy it into the colour image, then
+ * convert that to grey. */
+void run_mirror_copy_gray(const unsigned char *s,unsigned char *d,int w,int h,int t) {
+	static std::vector<unsigned char> mirrored,color;
+	mirrored.resize(3*size_t(w)*h);color.resize(3*size_t(w)*h);
+	mirrorRgb(s,&mirrored[0],w,h,t);
+	memcpy(&color[0],&mirrored[0],color.size());
+	gray_original(&color[0],d,w,h);
+}
+void run_mirror_gray(const unsigned char *s,unsigned char *d,int w,int h,int t) {mirrorRgbToGray(s,d,w,h,w,t);}
+
+/** Thresholds |a-b| as cvAbsDiff() followed by cvThreshold() with
+ * CV_THRESH_BINARY, and returns the number of set pixels. */
+int diff_threshold_original(const unsigned char *a,const unsigned char *b,unsigned char *d,int n,int threshold) {
+	int c=0;
+	for(int k=0;k<n;k++) {
+		d[k]=abs(a[k]-b[k])>threshold?255:0;
+		c+=d[k]!=0;
+	}
+	return c;
+}
+
+/** The images that the motion detection works on, kept between frames. */
+struct motion_images {
+	std::vector<unsigned char> gray,old,background,motion,presence;
+	void resize(size_t n) {gray.resize(n);old.resize(n);background.resize(n);motion.resize(n);presence.resize(n);}
+};
+
+/** The motion detection before it was fused into one pass: the grey
+ * conversion, a copy of the grey frame for the next frame, and absDiff and
+ * threshold against both the previous frame and the background. */
+void run_motion_separate(const unsigned char *s,unsigned char *,int w,int h,int t) {
+	static motion_images m;
+	size_t n=size_t(w)*h;
+	m.resize(n);
+	memcpy(&m.old[0],&m.gray[0],n);
+	mirrorRgbToGray(s,&m.gray[0],w,h,w,t);
+	diff_threshold_original(&m.old[0],&m.gray[0],&m.motion[0],n,50);
+	diff_threshold_original(&m.background[0],&m.gray[0],&m.presence[0],n,50);
+}
+template<int scale>
+void run_motion_fused(const unsigned char *s,unsigned char *,int w,int h,int t) {
+	static motion_images m;
+	int mc,pc;
+	m.resize(size_t(w/scale)*(h/scale));
+	updateMotionMasks(s,w,h,scale,&m.gray[0],&m.background[0],&m.motion[0],&m.presence[0],w/scale,50,mc,pc,t);
+}
+
+/** Checks the mirror kernels against the original loop, and the grey
+ * conversion against mirroring followed by the conversion of OpenCV.
+ * \return The number of widths on which they differ. */
+int check_mirror() {
+	int bad=0,h=3;
+	for(int w=1;w<=80;w++) {
+		std::vector<unsigned char> src(3*w*h),ref(3*w*h),a(3*w*h),b(3*w*h);
+		random_bytes(src,w);
+		mirror_original(&src[0],&ref[0],w,h);
+		mirrorRgbScalar(&src[0],&a[0],w,h);
+		mirrorRgb(&src[0],&b[0],w,h,2);
+		if(memcmp(&ref[0],&a[0],ref.size())!=0) {fprintf(stderr,"image_bench: mirror_scalar differs at width %d\n",w);bad++;}
+		if(memcmp(&ref[0],&b[0],ref.size())!=0) {fprintf(stderr,"image_bench: mirror differs at width %d\n",w);bad++;}
+
+		// The grey rows are written with a stride larger than the width,
+		// and the padding must be left alone
+		int gs=w+5;
+		std::vector<unsigned char> gref(gs*h,7),g(gs*h,7);
+		for(int y=0;y<h;y++) gray_original(&ref[3*w*y],&gref[gs*y],w,1);
+		mirrorRgbToGray(&src[0],&g[0],w,h,gs,2);
+		if(g!=gref) {fprintf(stderr,"image_bench: mirror_gray differs at width %d\n",w);bad++;}
+	}
+	return bad;
+}
+
+/** Checks the fused motion detection against the separate steps, on a
+ * range of widths, scales and thresholds, including thresholds outside
+ * [0,255]. At scales above one, the reference averages the full size grey
+ * image over each block.
+ * \return The number of cases in which they differ. */
+int check_motion() {
+	const int thresholds[]={-5,-1,0,1,50,128,254,255,256,1000};
+	int bad=0,h=9;
+	for(int scale=1;scale<=4;scale++) for(int w=1;w<=80;w++) for(int ti=0;ti<int(sizeof(thresholds)/sizeof(*thresholds));ti++) {
+		int th=thresholds[ti],ow=w/scale,oh=h/scale,gs=ow+3,n=gs*oh;
+		std::vector<unsigned char> src(3*w*h),full(w*h),prev(n),bg(n),gray(n),rm(n,9),rp(n,9),fm(n,9),fp(n,9);
+		random_bytes(src,w*37+ti);
+		random_bytes(prev,w*41+ti);
+		random_bytes(bg,w*43+ti);
+		std::vector<unsigned char> rg=prev;
+		int rmc=0,rpc=0,fmc,fpc;
+		mirrorRgbToGray(&src[0],&full[0],w,h,w,1);
+		for(int y=0;y<oh;y++) for(int x=0;x<ow;x++) {
+			int sum=scale*scale/2;
+			for(int j=0;j<scale;j++) for(int i=0;i<scale;i++) sum+=full[(y*scale+j)*w+x*scale+i];
+			rg[y*gs+x]=(unsigned char) (sum/(scale*scale));
+		}
+		for(int y=0;y<oh;y++) {
+			rmc+=diff_threshold_original(&prev[gs*y],&rg[gs*y],&rm[gs*y],ow,th);
+			rpc+=diff_threshold_original(&bg[gs*y],&rg[gs*y],&rp[gs*y],ow,th);
+		}
+		gray=prev;
+		updateMotionMasks(&src[0],w,h,scale,&gray[0],&bg[0],&fm[0],&fp[0],gs,th,fmc,fpc,2);
+		if(gray!=rg||fm!=rm||fp!=rp||fmc!=rmc||fpc!=rpc) {
+			fprintf(stderr,"image_bench: motion differs at width %d, scale %d, threshold %d\n",w,scale,th);
+			bad++;
+		}
+	}
+	return bad;
+}
+
+int main(int argc,char **argv) {
+	int w=argc>1?atoi(argv[1]):1280,h=argc>2?atoi(argv[2]):720;
+	double min_time=argc>3?atof(argv[3]):0.5;
+	int bad=check_mirror()+check_motion();
+	if(bad>0) {
+		fprintf(stderr,"image_bench: %d checks failed\n",bad);
+		return 1;
+	}
+
+#ifdef _OPENMP
+	int nt=omp_get_max_threads();
+#else
+	int nt=1;
+#endif
+	const bench_kernel kernels[]={
+		{"mirror_original",1,run_mirror_original,6},
+		{"mirror_scalar",1,run_mirror_scalar,6},
+		{"mirror",1,run_mirror,6},
+		{"mirror",nt,run_mirror,6},
+		{"mirror_copy_gray",1,run_mirror_copy_gray,4},
+		{"mirror_gray",1,run_mirror_gray,4},
+		{"mirror_gray",nt,run_mirror_gray,4},
+		{"motion_separate",1,run_motion_separate,6},
+		{"motion_fused",1,run_motion_fused<1>,6},
+		{"motion_fused",nt,run_motion_fused<1>,6},
+		{"motion_fused_half",1,run_motion_fused<2>,3},
+		{"motion_fused_quarter",1,run_motion_fused<4>,3}
+	};
+	const int nk=sizeof(kernels)/sizeof(*kernels);
+
+	std::vector<unsigned char> src(3*size_t(w)*h),dst(3*size_t(w)*h);
+	random_bytes(src,1);
+	puts("kernel,isa,width,height,threads,frames,us_per_frame,gb_per_s,frame_pct");
+	for(int k=0;k<nk;k++) {
+		if(k>0&&kernels[k].threads==kernels[k-1].threads&&kernels[k].run==kernels[k-1].run) continue;
+		const bench_kernel &b=kernels[k];
+		b.run(&src[0],&dst[0],w,h,b.threads);
+		int frames=0;
+		bench_clock::time_point t0=bench_clock::now();
+		double t;
+		do {
+			b.run(&src[0],&dst[0],w,h,b.threads);
+			frames++;
+		} while((t=seconds_since(t0))<min_time);
+		double per=t/frames;
+		printf("%s,%s,%d,%d,%d,%d,%.1f,%.2f,%.3f\n",b.name,imageKernelsIsa(),w,h,b.threads,frames,
+		       per*1e6,double(b.bytes_per_pixel)*w*h/per*1e-9,per*60*100);
+	}
+	return 0;
+}
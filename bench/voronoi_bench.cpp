@@ -0,0 +1,981 @@
+// Benchmarks for the Voro++2D core and ofxVoronoi, run without a window.
+//
+// The core benchmarks only need the library sources:
+//
+//   g++ -O2 -std=c++11 -Isrc/ofxVoronoi/libs/Voro++2D -o voronoi_bench
+//       bench/voronoi_bench.cpp src/ofxVoronoi/libs/Voro++2D/*.cpp
+//
+// To also benchmark ofxVoronoi::generate() and relax(), define
+// VORONOI_BENCH_OFX and compile this file together with
+// src/ofxVoronoi/src/ofxVoronoi.cpp against a compiled openFrameworks
+// library, in the same way as any other openFrameworks source. Only the
+// math types are used, so no window or GL context is created.
+//
+// Usage: voronoi_bench [max_seeds] [min_time] [budget]
+//
+// Every benchmark runs at 10^2, 10^3, ... seeds up to max_seeds (default
+// 10^6), on each seed distribution. Each case runs in its own child process,
+// so that the reported peak resident set size belongs to that case alone.
+// Samples are collected until min_time seconds (default 0.5) have elapsed.
+// Once a case takes longer than budget seconds (default 60), the larger
+// sizes of that benchmark and distribution are skipped.
+//
+// The results are written to standard output as CSV with the columns
+//
+//   benchmark,distribution,seeds,samples,cells_per_s,p50_us,p99_us,peak_rss_kb
+//
+// where the latency percentiles are taken over individual put() calls for
+// "put", individual cells for the cell computations, and whole calls or
+// passes for the other benchmarks. For the core benchmarks, the throughput comes from
+// separate passes without per-call timing, since the clock reads would
+// otherwise make up a large part of the measured time. "compute_all_cells"
+// loops over the blocks row by row, "hilbert" loops along the Hilbert curve
+// with c_loop_hilbert_2d, and "sort_hilbert" does the same after reordering
+// the particles in memory with sort_hilbert(). "metrics" computes the
+// metrics of all cells with cell_metrics_2d, in parallel if compiled with
+// OpenMP. The "hotspot" distribution, where the density differs by a factor
+// of about 100, shows how well the threads are balanced. "put_concurrent"
+// fills a container from several threads with put_concurrent(), with the
+// blocks sized for uniform seeds, and "put_concurrent_sampled" sizes them
+// from every sixteenth seed instead. "find_voronoi_cell",
+// "find_voronoi_cell_shuffled", "locator" and "locator_batch" find the cells
+// that the pixels of a 1280x720 image lie in, so their cells_per_s column
+// counts queries. The first two use the container's find_voronoi_cell() on the
+// pixels in row order and in a random order. "locator" uses a
+// voronoi_locator_2d in row order, and "locator_batch" passes the same random
+// order as "find_voronoi_cell_shuffled" to the locator's find_batch().
+//
+// Usage: voronoi_bench check [seeds]
+//
+// Instead of timing anything, this checks on inputs of about the given number
+// of seeds (default 2000) that every way of computing a tessellation gives
+// the same cells as looping over a container_2d with c_loop_all_2d. The
+// variants are the ordered and Hilbert loops, containers filled from several
+// threads with put_concurrent(), a container sorted by sort_hilbert(), a
+// container with dynamic tracking, and the tiled driver. The tracked
+// container is checked after a round of random moves, against a fresh
+// tessellation of the moved seeds, and again after the moves are undone. For
+// each cell the vertices must match within a tolerance, the areas must agree,
+// and every neighbor across an edge that is longer than the tolerance must
+// also be a neighbor in the other tessellation. The concurrently filled
+// containers must also hold the same particles in each block as the
+// reference, with every particle ID exactly once.
+//
+// The cell areas from sum_cell_areas() must add up to the area of the domain,
+// counting the cell of a duplicated seed only once, and the per-cell metrics,
+// area histogram and total area of cell_metrics_2d must match a serial loop.
+// voronoi_locator_2d must find the same cells as find_voronoi_cell(), for the
+// pixels of an image and for random points inside and around the domain. In
+// addition, range_scheduler_2d must hand out every item exactly once.
+//
+// As well as the distributions above, the inputs include seeds on a few lines,
+// duplicated seeds, and seeds on an exact grid, where every vertex is shared
+// by four cocircular seeds. Each mismatch is reported on standard error, and
+// the exit status is nonzero if there are any.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <utility>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "voro++_2d.h"
+using namespace voro;
+
+#ifdef VORONOI_BENCH_OFX
+#include "ofxVoronoi.h"
+#endif
+
+// The seeds are spread over a domain with the size of the app's window
+const double width=1280,height=720;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/** A small deterministic random number generator, so that every run and
+ * every child process sees the same seeds. */
+struct bench_random {
+	unsigned long long s;
+	bench_random(unsigned long long seed) : s(seed*2654435761ull+1) {}
+	/** Returns a uniform random number in [0,1). */
+	inline double uniform() {
+		s^=s<<13;s^=s>>7;s^=s<<17;
+		return (s>>11)*(1.0/9007199254740992.0);
+	}
+	/** Returns a normally distributed random number. */
+	inline double normal() {
+		double u=uniform(),v=uniform();
+		return sqrt(-2*log(u+1e-300))*cos(2*M_PI*v);
+	}
+};
+
+/** Uniform random seeds. */
+void uniform_seeds(int n,vector<double> &v) {
+	bench_random r(1);
+	for(int i=0;i<n;i++) {v.push_back(r.uniform()*width);v.push_back(r.uniform()*height);}
+}
+
+/** Seeds in Gaussian clusters, with about a thousand seeds per cluster and
+ * all seeds clipped to the domain. */
+void clustered_seeds(int n,vector<double> &v) {
+	bench_random r(2);
+	int k,nc=n/1000+4;
+	double x,y,sig=0.02*width;
+	vector<double> c;
+	for(k=0;k<nc;k++) {c.push_back(r.uniform()*width);c.push_back(r.uniform()*height);}
+	while(int(v.size())<2*n) {
+		k=int(r.uniform()*nc);
+		x=c[2*k]+sig*r.normal();y=c[2*k+1]+sig*r.normal();
+		if(x>=0&&x<width&&y>=0&&y<height) {v.push_back(x);v.push_back(y);}
+	}
+}
+
+/** Seeds on a square grid, perturbed by a tiny amount, so that most
+ * vertices are shared by four nearly cocircular seeds. */
+void grid_seeds(int n,vector<double> &v) {
+	bench_random r(3);
+	int i,nx=int(sqrt(n*width/height))+1,ny=(n+nx-1)/nx;
+	double dx=width/nx,dy=height/ny;
+	for(i=0;i<n;i++) {
+		v.push_back((i%nx+0.5)*dx+1e-9*dx*(r.uniform()-0.5));
+		v.push_back((i/nx+0.5)*dy+1e-9*dy*(r.uniform()-0.5));
+	}
+}
+
+/** Seeds in the beehive layout of ofApp::generateBeehivePoints(): rows of
+ * a grid with every other row shifted by half a column, and a random offset
+ * added to every seed. The grid has the aspect ratio of the domain and the
+ * offset spans the same fraction of a column as in the app. Seeds outside the
+ * domain are dropped. */
+void beehive_seeds(int n,vector<double> &v) {
+	bench_random r(4);
+	int i,j,sx=int(sqrt(n*width/height))+1,sy=(n+sx-1)/sx;
+	double colx=floor(width/sx),coly=floor(height/sy),var=0.375*colx,x,y;
+	for(i=-1;i<sx+1;i++) for(j=-1;j<sy+1;j++) {
+		x=i*width/sx+colx/2;y=j*height/sy+coly/2;
+		if(j%2) x+=colx/2;
+		x+=var*r.uniform();y+=var*r.uniform();
+		if(x>=0&&x<width&&y>=0&&y<height&&int(v.size())<2*n) {v.push_back(x);v.push_back(y);}
+	}
+}
+
+/** Seeds where every other seed lies in a hot spot covering one percent of
+ * the domain and the rest are uniform, so that the density differs by a
+ * factor of about 100, as it does around a person in front of the camera. */
+void hotspot_seeds(int n,vector<double> &v) {
+	bench_random r(8);
+	for(int i=0;i<n;i++) {
+		if(i&1) {v.push_back(r.uniform()*width);v.push_back(r.uniform()*height);}
+		else {v.push_back((0.6+0.1*r.uniform())*width);v.push_back((0.3+0.1*r.uniform())*height);}
+	}
+}
+
+struct bench_distribution {
+	const char *name;
+	void (*make)(int,vector<double>&);
+};
+
+const bench_distribution distributions[]={
+	{"uniform",uniform_seeds},
+	{"clustered",clustered_seeds},
+	{"grid",grid_seeds},
+	{"beehive",beehive_seeds},
+	{"hotspot",hotspot_seeds}
+};
+
+/** Seeds on three horizontal lines and one vertical line, so that many
+ * triples of seeds are exactly collinear. */
+void collinear_seeds(int n,vector<double> &v) {
+	bench_random r(5);
+	for(int i=0;i<n;i++) {
+		switch(i&3) {
+			case 3: v.push_back(0.5*width);v.push_back(r.uniform()*height);break;
+			default: v.push_back(r.uniform()*width);v.push_back((1+(i&3))*height/4);
+		}
+	}
+}
+
+/** Uniform random seeds where every tenth seed is an exact copy of an earlier
+ * one. */
+void duplicate_seeds(int n,vector<double> &v) {
+	bench_random r(6);
+	for(int i=0;i<n;i++) {
+		if(i%10==9) {
+			int k=int(r.uniform()*(i-1));
+			v.push_back(v[2*k]);v.push_back(v[2*k+1]);
+		} else {v.push_back(r.uniform()*width);v.push_back(r.uniform()*height);}
+	}
+}
+
+/** Seeds at the centers of an exact square grid, with a spacing that is a
+ * power of two so that the positions are represented exactly. */
+void cocircular_seeds(int n,vector<double> &v) {
+	int i,j;
+	double dx=8;
+	while(dx*dx*n>width*height) dx*=0.5;
+	while(4*dx*dx*n<=width*height) dx*=2;
+	for(j=0;(j+1)*dx<=height;j++) for(i=0;(i+1)*dx<=width;i++) if(int(v.size())<2*n) {
+		v.push_back((i+0.5)*dx);v.push_back((j+0.5)*dx);
+	}
+}
+
+const bench_distribution check_distributions[]={
+	{"uniform",uniform_seeds},
+	{"clustered",clustered_seeds},
+	{"grid",grid_seeds},
+	{"beehive",beehive_seeds},
+	{"hotspot",hotspot_seeds},
+	{"collinear",collinear_seeds},
+	{"duplicate",duplicate_seeds},
+	{"cocircular",cocircular_seeds}
+};
+
+/** The result of one benchmark case. */
+struct bench_result {
+	/** The number of cells or particles processed. */
+	double cells;
+	/** The total time taken in seconds. */
+	double time;
+	/** The latency samples in microseconds. */
+	vector<double> lat;
+	bench_result() : cells(0), time(0) {}
+	/** Adds a timed pass that processed a number of cells. */
+	inline void add(double t,double c) {time+=t;cells+=c;}
+	/** Adds a latency sample. */
+	inline void sample(double t) {lat.push_back(t*1e6);}
+};
+
+inline double seconds_since(bench_clock::time_point t0) {
+	return std::chrono::duration<double>(bench_clock::now()-t0).count();
+}
+
+/** Creates a container over the domain with about optimal_particles_2d seeds
+ * per block. */
+container_2d *make_container(int n) {
+	double ilscale=sqrt(n/(optimal_particles_2d*width*height));
+	return new container_2d(0,width,0,height,int(width*ilscale)+1,int(height*ilscale)+1,false,false,8);
+}
+
+/** Fills a container from several threads at once with put_concurrent(), if
+ * the code is compiled with OpenMP.
+ * \param[in] con the container, which must be empty.
+ * \param[in] sampled whether to give begin_concurrent() every sixteenth seed
+ *                    as a sample of the density. */
+void put_concurrent_seeds(container_2d &con,vector<double> &v,bool sampled) {
+	int i,n=v.size()/2;
+	vector<double> s;
+	if(sampled) for(i=0;i<n;i+=16) {s.push_back(v[2*i]);s.push_back(v[2*i+1]);}
+	con.begin_concurrent(n,s.empty()?NULL:&s[0],int(s.size()/2));
+#pragma omp parallel for
+	for(i=0;i<n;i++) con.put_concurrent(i,v[2*i],v[2*i+1]);
+	con.end_concurrent();
+}
+
+/** Times putting all of the seeds into empty containers, and then times
+ * individual put() calls in one further pass. */
+void bench_put(vector<double> &v,double min_time,bench_result &r) {
+	int i,n=v.size()/2;
+	container_2d *con;
+	do {
+		con=make_container(n);
+		bench_clock::time_point t0=bench_clock::now();
+		for(i=0;i<n;i++) con->put(i,v[2*i],v[2*i+1]);
+		r.add(seconds_since(t0),n);
+		delete con;
+	} while(r.time<min_time);
+	con=make_container(n);
+	for(i=0;i<n;i++) {
+		bench_clock::time_point t0=bench_clock::now();
+		con->put(i,v[2*i],v[2*i+1]);
+		r.sample(seconds_since(t0));
+	}
+	delete con;
+}
+
+/** Times compute_all_cells(), and then times the computation of each cell in
+ * one further pass, looping over the container in the same way. */
+void bench_compute(vector<double> &v,double min_time,bench_result &r) {
+	int i,n=v.size()/2;
+	container_2d *con=make_container(n);
+	for(i=0;i<n;i++) con->put(i,v[2*i],v[2*i+1]);
+	do {
+		bench_clock::time_point t0=bench_clock::now();
+		con->compute_all_cells();
+		r.add(seconds_since(t0),n);
+	} while(r.time<min_time);
+	voronoicell_2d c;
+	c_loop_all_2d vl(*con);
+	if(vl.start()) do {
+		bench_clock::time_point t0=bench_clock::now();
+		con->compute_cell(c,vl);
+		r.sample(seconds_since(t0));
+	} while(vl.inc());
+	delete con;
+}
+
+/** Times filling empty containers from several threads at once with
+ * put_concurrent(), from begin_concurrent() to end_concurrent().
+ * \param[in] sampled whether to size the blocks from a sample of the seeds. */
+void bench_put_concurrent(vector<double> &v,bool sampled,double min_time,bench_result &r) {
+	int n=v.size()/2;
+	do {
+		container_2d *con=make_container(n);
+		bench_clock::time_point t0=bench_clock::now();
+		put_concurrent_seeds(*con,v,sampled);
+		double t=seconds_since(t0);
+		r.add(t,n);
+		r.sample(t);
+		delete con;
+	} while(r.time<min_time||r.lat.size()<3);
+}
+
+/** Times computing all cells along the Hilbert curve with c_loop_hilbert_2d,
+ * and then times the computation of each cell in one further pass.
+ * \param[in] sorted whether to first reorder the particles in memory with
+ *                   sort_hilbert(), which is not included in the times. */
+void bench_hilbert(vector<double> &v,bool sorted,double min_time,bench_result &r) {
+	int i,n=v.size()/2;
+	container_2d *con=make_container(n);
+	for(i=0;i<n;i++) con->put(i,v[2*i],v[2*i+1]);
+	if(sorted) con->sort_hilbert();
+	voronoicell_2d c;
+	c_loop_hilbert_2d vl(*con);
+	do {
+		bench_clock::time_point t0=bench_clock::now();
+		if(vl.start()) do con->compute_cell(c,vl);
+		while(vl.inc());
+		r.add(seconds_since(t0),n);
+	} while(r.time<min_time);
+	if(vl.start()) do {
+		bench_clock::time_point t0=bench_clock::now();
+		con->compute_cell(c,vl);
+		r.sample(seconds_since(t0));
+	} while(vl.inc());
+	delete con;
+}
+
+/** Times computing the metrics of all cells with cell_metrics_2d, which
+ * shares the particles between threads with a range_scheduler_2d if the code
+ * is compiled with OpenMP. */
+void bench_metrics(vector<double> &v,double min_time,bench_result &r) {
+	int i,n=v.size()/2;
+	container_2d *con=make_container(n);
+	for(i=0;i<n;i++) con->put(i,v[2*i],v[2*i+1]);
+	cell_metrics_2d m;
+	do {
+		bench_clock::time_point t0=bench_clock::now();
+		m.compute(*con);
+		double t=seconds_since(t0);
+		r.add(t,n);
+		r.sample(t);
+	} while(r.time<min_time||r.lat.size()<3);
+	delete con;
+}
+
+/** Adds the centers of the pixels of a 1280x720 image covering the domain to
+ * a list of query points, row by row. */
+void pixel_queries(vector<double> &q) {
+	for(int j=0;j<720;j++) for(int i=0;i<1280;i++) {
+		q.push_back((i+0.5)*width/1280);q.push_back((j+0.5)*height/720);
+	}
+}
+
+/** Times finding the cells that the pixels of an image lie in, either with
+ * the container's find_voronoi_cell(), or with a voronoi_locator_2d whose
+ * build() is not included in the times.
+ * \param[in] mode 0 for find_voronoi_cell() in row order, 1 for the same with
+ *                 the pixels shuffled, 2 for the locator's find() in row
+ *                 order, or 3 for the locator's find_batch() with the pixels
+ *                 shuffled. */
+void bench_locate(vector<double> &v,int mode,double min_time,bench_result &r) {
+	int i,n=v.size()/2,pid;
+	double rx,ry;
+	container_2d *con=make_container(n);
+	for(i=0;i<n;i++) con->put(i,v[2*i],v[2*i+1]);
+	voronoi_locator_2d loc(*con);
+	loc.build();
+	vector<double> q;
+	pixel_queries(q);
+	int m=q.size()/2;
+	vector<int> pids(m);
+	if(mode==1||mode==3) {
+		bench_random rs(9);
+		for(i=m-1;i>0;i--) {
+			int k=int(rs.uniform()*(i+1));
+			std::swap(q[2*i],q[2*k]);std::swap(q[2*i+1],q[2*k+1]);
+		}
+	}
+	do {
+		bench_clock::time_point t0=bench_clock::now();
+		switch(mode) {
+			case 0: case 1: for(i=0;i<m;i++) con->find_voronoi_cell(q[2*i],q[2*i+1],rx,ry,pid);break;
+			case 2: for(i=0;i<m;i++) loc.find(q[2*i],q[2*i+1],rx,ry,pid);break;
+			case 3: loc.find_batch(m,&q[0],&pids[0]);
+		}
+		double t=seconds_since(t0);
+		r.add(t,m);
+		r.sample(t);
+	} while(r.time<min_time||r.lat.size()<3);
+	delete con;
+}
+
+#ifdef VORONOI_BENCH_OFX
+/** Copies the seeds into ofPoint form. */
+void of_points(vector<double> &v,vector<ofPoint> &pts) {
+	for(unsigned int i=0;i<v.size();i+=2) pts.push_back(ofPoint(v[i],v[i+1]));
+}
+
+/** Times full, uncached generate() calls. */
+void bench_generate(vector<double> &v,bool ordered,double min_time,bench_result &r) {
+	vector<ofPoint> pts;
+	of_points(v,pts);
+	ofxVoronoi vor;
+	vor.setCacheEnabled(false);
+	vor.setBounds(ofRectangle(0,0,width,height));
+	do {
+		vor.setPoints(pts);
+		bench_clock::time_point t0=bench_clock::now();
+		vor.generate(ordered);
+		double t=seconds_since(t0);
+		r.add(t,pts.size());
+		r.sample(t);
+	} while(r.time<min_time||r.lat.size()<3);
+}
+
+/** Times successive relax() steps. */
+void bench_relax(vector<double> &v,double min_time,bench_result &r) {
+	vector<ofPoint> pts;
+	of_points(v,pts);
+	ofxVoronoi vor;
+	vor.setBounds(ofRectangle(0,0,width,height));
+	vor.setPoints(pts);
+	vor.generate();
+	do {
+		bench_clock::time_point t0=bench_clock::now();
+		vor.relax();
+		double t=seconds_since(t0);
+		r.add(t,pts.size());
+		r.sample(t);
+	} while(r.time<min_time||r.lat.size()<3);
+}
+#endif
+
+/** The tolerance used when comparing positions and areas, relative to the
+ * size of the domain. */
+const double check_tolerance=1e-7;
+
+/** A cell of a tessellation in global coordinates, as used by the checks. */
+struct check_cell {
+	/** Whether the cell was computed. */
+	bool computed;
+	/** The area of the cell. */
+	double area;
+	/** The vertices of the cell, as (x,y) pairs. */
+	vector<double> v;
+	/** The neighbor across each edge, where edge k joins vertex k to
+	 * vertex k+1. */
+	vector<int> ne;
+	check_cell() : computed(false), area(0) {}
+};
+
+typedef vector<check_cell> check_tessellation;
+
+/** Stores a computed cell in a tessellation.
+ * \param[in] c the cell.
+ * \param[in] n the ID of its particle.
+ * \param[in] (x,y) the position of its particle.
+ * \param[in] t the tessellation. */
+void store_cell(voronoicell_neighbor_2d &c,int n,double x,double y,check_tessellation &t) {
+	check_cell &cc=t[n];
+	cc.computed=true;cc.area=c.area();
+	cc.v.clear();cc.ne.clear();
+	int k=0;
+	do {
+		cc.v.push_back(x+0.5*c.pts[2*k]);cc.v.push_back(y+0.5*c.pts[2*k+1]);
+		cc.ne.push_back(c.ne[k]);
+		k=c.ed[2*k];
+	} while(k!=0);
+}
+
+/** Computes the cells visited by a loop and stores them in a
+ * tessellation. */
+template<class c_loop_2d>
+void compute_cells(container_2d &con,c_loop_2d &vl,check_tessellation &t) {
+	voronoicell_neighbor_2d c;
+	double *pp;
+	if(vl.start()) do if(con.compute_cell(c,vl)) {
+		pp=con.p[vl.ij]+con.ps*vl.q;
+		store_cell(c,con.id[vl.ij][vl.q],*pp,pp[1],t);
+	} while(vl.inc());
+}
+
+/** Returns whether every vertex of one cell lies within a distance of some
+ * vertex of another. */
+bool vertices_covered(check_cell &a,check_cell &b,double tol) {
+	for(unsigned int i=0;i<a.v.size();i+=2) {
+		bool found=false;
+		for(unsigned int j=0;j<b.v.size()&&!found;j+=2)
+			found=fabs(a.v[i]-b.v[j])<=tol&&fabs(a.v[i+1]-b.v[j+1])<=tol;
+		if(!found) return false;
+	}
+	return true;
+}
+
+/** Returns whether every neighbor of one cell across an edge longer than a
+ * tolerance is also a neighbor of another. Shorter edges come from nearly
+ * degenerate vertices, and may be resolved either way. Duplicated seeds cut
+ * along the same line, so which of them is recorded as the neighbor depends
+ * on the order that they are found in, and the neighbor IDs are therefore
+ * compared after mapping each seed to the first seed at its position. */
+bool neighbors_covered(check_cell &a,check_cell &b,vector<int> &first,double tol) {
+	int k,l,m=a.ne.size(),e;
+	for(k=0;k<m;k++) {
+		l=(k+1)%m;
+		double dx=a.v[2*l]-a.v[2*k],dy=a.v[2*l+1]-a.v[2*k+1];
+		if(dx*dx+dy*dy<=tol*tol) continue;
+		bool found=false;
+		for(e=a.ne[k],l=0;l<int(b.ne.size())&&!found;l++)
+			found=b.ne[l]==e||(e>=0&&b.ne[l]>=0&&first[b.ne[l]]==first[e]);
+		if(!found) return false;
+	}
+	return true;
+}
+
+/** Compares a tessellation with the reference and reports any differences.
+ * \return The number of cells that differ. */
+int compare_tessellations(const char *dist,const char *variant,check_tessellation &ref,check_tessellation &t,vector<int> &first) {
+	double tol=check_tolerance*width;
+	int n,bad=0;
+	for(n=0;n<int(ref.size());n++) {
+		check_cell &a=ref[n],&b=t[n];
+		const char *e=NULL;
+		if(a.computed!=b.computed) e="computed";
+		else if(!a.computed) continue;
+		else if(fabs(a.area-b.area)>tol*width) e="area";
+		else if(!vertices_covered(a,b,tol)||!vertices_covered(b,a,tol)) e="vertices";
+		else if(!neighbors_covered(a,b,first,tol)||!neighbors_covered(b,a,first,tol)) e="neighbors";
+		if(e!=NULL&&bad++<5) fprintf(stderr,"voronoi_bench: %s/%s: cell %d differs in %s\n",dist,variant,n,e);
+	}
+	if(bad>5) fprintf(stderr,"voronoi_bench: %s/%s: %d cells differ\n",dist,variant,bad);
+	return bad;
+}
+
+/** Finds the first seed at the position of each seed.
+ * \param[in] v the seed positions.
+ * \param[out] first the ID of the first seed at each position. */
+void find_first_seeds(vector<double> &v,vector<int> &first) {
+	map<pair<double,double>,int> m;
+	for(int n=0;n<int(v.size()/2);n++)
+		first.push_back(m.insert(make_pair(make_pair(v[2*n],v[2*n+1]),n)).first->second);
+}
+
+/** Checks that the cell areas from a container's sum_cell_areas() add up to
+ * the area of the domain. A duplicated seed has the same cell as the first
+ * seed at its position, so the areas of the duplicates in the reference
+ * tessellation are added to the domain area.
+ * \return 1 if the check fails, 0 otherwise. */
+int check_area(const char *dist,container_2d &con,vector<int> &first,check_tessellation &ref) {
+	double sum=con.sum_cell_areas(),area=width*height;
+	for(int n=0;n<int(ref.size());n++) if(first[n]!=n) area+=ref[n].area;
+	if(fabs(sum-area)<=check_tolerance*width*height) return 0;
+	fprintf(stderr,"voronoi_bench: %s: cell areas add up to %.12g instead of %.12g\n",dist,sum,area);
+	return 1;
+}
+
+/** Checks the metrics from cell_metrics_2d, which shares the cells between
+ * threads when compiled with OpenMP, against a serial loop over the container.
+ * Every entry must have the right particle ID, area, perimeter, centroid and
+ * radius, and the area histogram, the number of computed cells, and the total
+ * area must agree.
+ * \return 1 if the check fails, 0 otherwise. */
+int check_metrics(const char *dist,container_2d &con) {
+	const int nbins=16;
+	double tol=check_tolerance*width,total=0,cx,cy,a;
+	int k,l,b,bad=0,computed=0,hist[nbins];
+	cell_metrics_2d m(true,nbins,4*width*height/con.total_particles());
+	m.compute(con);
+	for(k=0;k<nbins;k++) hist[k]=0;
+	voronoicell_2d c;
+	c_loop_all_2d vl(con);
+	if(vl.start()) do {
+		l=m.index(vl.ij,vl.q);
+		const char *e=NULL;
+		if(m.id[l]!=con.id[vl.ij][vl.q]) e="id";
+		else if(con.compute_cell(c,vl)) {
+			double *pp=con.p[vl.ij]+con.ps*vl.q;
+			a=c.area();c.centroid(cx,cy);
+			total+=a;computed++;
+			b=int(a*nbins/m.hmax);hist[b<nbins?b:nbins-1]++;
+			if(fabs(m.area[l]-a)>tol*width) e="area";
+			else if(fabs(m.perimeter[l]-c.perimeter())>tol) e="perimeter";
+			else if(fabs(m.centroid[2*l]-*pp-cx)>tol||fabs(m.centroid[2*l+1]-pp[1]-cy)>tol) e="centroid";
+			else if(fabs(m.radius[l]-0.5*sqrt(c.max_radius_squared()))>tol) e="radius";
+		} else if(m.area[l]!=0) e="area";
+		if(e!=NULL&&bad++<5) fprintf(stderr,"voronoi_bench: %s/metrics: entry %d differs in %s\n",dist,l,e);
+	} while(vl.inc());
+	if(computed!=m.computed) {
+		fprintf(stderr,"voronoi_bench: %s/metrics: %d cells computed instead of %d\n",dist,m.computed,computed);
+		bad++;
+	}
+	if(fabs(total-m.total_area)>check_tolerance*width*height) {
+		fprintf(stderr,"voronoi_bench: %s/metrics: total area %.12g instead of %.12g\n",dist,m.total_area,total);
+		bad++;
+	}
+	for(k=0;k<nbins;k++) if(hist[k]!=m.hist[k]) {
+		fprintf(stderr,"voronoi_bench: %s/metrics: histogram bin %d holds %d instead of %d\n",dist,k,m.hist[k],hist[k]);
+		bad++;
+	}
+	return bad>0?1:0;
+}
+
+/** Checks that range_scheduler_2d hands out every item exactly once, for a
+ * few numbers of items and grain sizes. The items in the first tenth of the
+ * range are made much slower than the rest, so that when there are several
+ * threads, the others steal from the thread that owns them.
+ * \return The number of cases that fail. */
+int check_scheduler() {
+	const int sizes[]={0,1,7,1000,100003},grains[]={1,schedule_grain_2d,1000};
+	int a,b,l,n,bad=0;
+	for(a=0;a<int(sizeof(sizes)/sizeof(*sizes));a++) for(b=0;b<int(sizeof(grains)/sizeof(*grains));b++) {
+		n=sizes[a];
+		vector<int> cnt(n,0);
+		range_scheduler_2d rs(n,grains[b]);
+#pragma omp parallel
+		{
+			int lo,hi,k,l;
+			double x=0;
+			while(rs.next(lo,hi)) for(l=lo;l<hi;l++) {
+				if(l<n/10) for(k=0;k<1000;k++) x+=sqrt(double(k+l));
+#pragma omp atomic
+				cnt[l]++;
+			}
+			if(x<0) puts("");
+		}
+		for(l=0;l<n&&cnt[l]==1;l++) {}
+		if(l<n) {
+			fprintf(stderr,"voronoi_bench: scheduler: item %d of %d with grain %d handed out %d times\n",l,n,grains[b],cnt[l]);
+			bad++;
+		}
+	}
+	return bad;
+}
+
+/** Checks that a container filled with put_concurrent() holds the same
+ * particles in each block as one filled with put(), at the same positions, and
+ * that every particle ID appears exactly once.
+ * \return The number of blocks or IDs that differ. */
+int check_concurrent(const char *dist,const char *variant,container_2d &ref,container_2d &con,vector<double> &v) {
+	int ij,q,k,bad=0;
+	vector<int> a,b,seen(v.size()/2,0);
+	for(ij=0;ij<con.nxy;ij++) {
+		for(q=0;q<con.co[ij];q++) {
+			k=con.id[ij][q];
+			double *pp=con.p[ij]+con.ps*q;
+			if(k<0||k>=int(seen.size())||*pp!=v[2*k]||pp[1]!=v[2*k+1]) {
+				if(bad++<5) fprintf(stderr,"voronoi_bench: %s/%s: block %d holds a wrong particle\n",dist,variant,ij);
+			} else seen[k]++;
+		}
+		a.assign(ref.id[ij],ref.id[ij]+ref.co[ij]);
+		b.assign(con.id[ij],con.id[ij]+con.co[ij]);
+		sort(a.begin(),a.end());sort(b.begin(),b.end());
+		if(a!=b&&bad++<5) fprintf(stderr,"voronoi_bench: %s/%s: block %d holds %d particles instead of %d\n",dist,variant,ij,con.co[ij],ref.co[ij]);
+	}
+	for(k=0;k<int(seen.size());k++) if(seen[k]!=1&&bad++<5)
+		fprintf(stderr,"voronoi_bench: %s/%s: particle %d appears %d times\n",dist,variant,k,seen[k]);
+	return bad;
+}
+
+/** Checks that voronoi_locator_2d finds the same cells as the container's
+ * find_voronoi_cell(), for the pixel centers of an image in row order and for
+ * random points inside and around the domain, each queried both one by one
+ * and with find_batch(). find_batch() keeps the order of the pixels and sorts
+ * the random points. Where several seeds are equally close, as
+ * for duplicated or cocircular seeds, either may be found, so the distances to
+ * the found seeds are compared rather than their IDs.
+ * \return The number of queries that differ. */
+int check_locator(const char *dist,container_2d &con,vector<double> &v) {
+	int i,l,pid,rpid,bad=0;
+	bool f,rf;
+	double x,y,rx,ry,rrx,rry,tol=check_tolerance*width;
+	vector<double> q;
+	pixel_queries(q);
+	int mp=q.size()/2;
+	bench_random r(10);
+	for(i=0;i<20000;i++) {
+		q.push_back((1.2*r.uniform()-0.1)*width);
+		q.push_back((1.2*r.uniform()-0.1)*height);
+	}
+	int m=q.size()/2;
+	vector<int> bpid(m);
+	voronoi_locator_2d loc(con);
+	loc.build();
+	loc.find_batch(mp,&q[0],&bpid[0]);
+	loc.find_batch(m-mp,&q[2*mp],&bpid[mp]);
+	for(l=0;l<2*m;l++) {
+		i=l<m?l:l-m;
+		x=q[2*i];y=q[2*i+1];
+		rf=con.find_voronoi_cell(x,y,rrx,rry,rpid);
+		if(l<m) f=loc.find(x,y,rx,ry,pid);
+		else {
+			pid=bpid[i];f=pid>=0;
+			if(f) {rx=v[2*pid];ry=v[2*pid+1];}
+		}
+		const char *e=NULL;
+		if(f!=rf) e="found";
+		else if(!f) continue;
+		else if(pid<0||pid>=int(v.size()/2)||rx!=v[2*pid]||ry!=v[2*pid+1]) e="position";
+		else if(fabs(sqrt((rx-x)*(rx-x)+(ry-y)*(ry-y))-sqrt((rrx-x)*(rrx-x)+(rry-y)*(rry-y)))>tol) e="distance";
+		if(e!=NULL&&bad++<5) fprintf(stderr,"voronoi_bench: %s/%s: query (%g,%g) differs in %s\n",dist,l<m?"locator":"locator_batch",x,y,e);
+	}
+	if(bad>5) fprintf(stderr,"voronoi_bench: %s/locator: %d queries differ\n",dist,bad);
+	return bad>0?1:0;
+}
+
+/** Computes the reference tessellation of a set of seeds, by looping over a
+ * new container with c_loop_all_2d. */
+void reference_cells(vector<double> &v,check_tessellation &t) {
+	int i,n=v.size()/2;
+	container_2d *con=make_container(n);
+	for(i=0;i<n;i++) con->put(i,v[2*i],v[2*i+1]);
+	c_loop_all_2d vl(*con);
+	compute_cells(*con,vl,t);
+	delete con;
+}
+
+/** Computes all cells with dynamic tracking enabled, then moves every seventh
+ * particle to a new position and back again, recomputing the dirty cells
+ * after each round.
+ * \param[in] v the initial seed positions.
+ * \param[in] w the seed positions after the first round of moves.
+ * \param[out] t1 the tessellation after the first round.
+ * \param[out] t2 the tessellation after the particles are moved back. */
+void tracked_cells(vector<double> &v,vector<double> &w,check_tessellation &t1,check_tessellation &t2) {
+	int i,n=v.size()/2;
+	container_2d *con=make_container(n);
+	for(i=0;i<n;i++) con->put(i,v[2*i],v[2*i+1]);
+	con->enable_tracking();
+	voronoicell_neighbor_2d c;
+	check_tessellation t(n);
+	for(int round=0;round<3;round++) {
+		if(round==1) for(i=0;i<n;i+=7) con->move(i,w[2*i],w[2*i+1]);
+		else if(round==2) for(i=0;i<n;i+=7) con->move(i,v[2*i],v[2*i+1]);
+		particle_order po;
+		con->take_dirty(po);
+		c_loop_order_2d vl(*con,po);
+		if(vl.start()) do {
+			int id=con->id[vl.ij][vl.q];
+			double *pp=con->p[vl.ij]+con->ps*vl.q;
+			if(con->compute_cell(c,vl)) {
+				con->record_cell(id,c);
+				store_cell(c,id,*pp,pp[1],t);
+			} else t[id].computed=false;
+		} while(vl.inc());
+		if(round==1) t1=t;
+	}
+	t2=t;
+	delete con;
+}
+
+/** Computes all cells with the tiled driver, going through temporary binary
+ * particle and tessellation files. */
+void tiled_cells(vector<double> &v,check_tessellation &t) {
+	char pname[256],tname[256];
+	sprintf(pname,"%s/voronoi_bench_%d.par",P_tmpdir,int(getpid()));
+	sprintf(tname,"%s/voronoi_bench_%d.tes",P_tmpdir,int(getpid()));
+	int i,n=v.size()/2;
+	container_2d *con=make_container(n);
+	for(i=0;i<n;i++) con->put(i,v[2*i],v[2*i+1]);
+	con->draw_particles_binary(pname);
+	delete con;
+
+	tiled_tessellation_2d tt(0,width,0,height,3,2,2*sqrt(width*height/n));
+	tt.partition(pname);
+	tt.compute(tname,binary_tessellation_neighbors);
+	{
+		tessellation_file_2d tf(tname);
+		for(i=0;i<tf.cells();i++) {
+			check_cell &cc=t[tf.id(i)];
+			cc.computed=true;cc.area=tf.area(i);
+			cc.v.resize(2*tf.vertices(i));cc.ne.resize(tf.vertices(i));
+			for(int k=0;k<tf.vertices(i);k++) {
+				tf.vertex(i,k,cc.v[2*k],cc.v[2*k+1]);
+				cc.ne[k]=tf.neighbor(i,k);
+			}
+		}
+	}
+	remove(pname);remove(tname);
+}
+
+/** Runs every check on every check distribution.
+ * \param[in] n the number of seeds.
+ * \return The number of checks that failed. */
+int run_checks(int n) {
+	int d,i,bad=check_scheduler();
+	const int nd=sizeof(check_distributions)/sizeof(*check_distributions);
+	for(d=0;d<nd;d++) {
+		const char *dist=check_distributions[d].name;
+		vector<double> v;
+		check_distributions[d].make(n,v);
+		int m=v.size()/2;
+
+		// Compute the reference tessellation
+		check_tessellation ref(m);
+		container_2d *con=make_container(m);
+		for(i=0;i<m;i++) con->put(i,v[2*i],v[2*i+1]);
+		c_loop_all_2d vla(*con);
+		compute_cells(*con,vla,ref);
+		vector<int> first;
+		find_first_seeds(v,first);
+		bad+=check_area(dist,*con,first,ref);
+		bad+=check_metrics(dist,*con);
+		bad+=check_locator(dist,*con,v);
+
+		// Fill containers from several threads at once, with the blocks
+		// sized for uniform seeds and from a sample of the seeds
+		for(int sampled=0;sampled<2;sampled++) {
+			const char *variant=sampled?"concurrent_sampled":"concurrent";
+			container_2d *cc=make_container(m);
+			put_concurrent_seeds(*cc,v,sampled==1);
+			check_tessellation t(m);
+			c_loop_all_2d vlc(*cc);
+			compute_cells(*cc,vlc,t);
+			if(check_concurrent(dist,variant,*con,*cc,v)+compare_tessellations(dist,variant,ref,t,first)>0) bad++;
+			delete cc;
+		}
+
+		// Visit the particles of the same container in reverse order,
+		// and along the Hilbert curve
+		{
+			check_tessellation t(m);
+			particle_order po;
+			for(i=0;i<con->nxy;i++) for(int q=con->co[i]-1;q>=0;q--) po.add(i,q);
+			c_loop_order_2d vlo(*con,po);
+			compute_cells(*con,vlo,t);
+			if(compare_tessellations(dist,"order",ref,t,first)) bad++;
+		}
+		{
+			check_tessellation t(m);
+			c_loop_hilbert_2d vlh(*con);
+			compute_cells(*con,vlh,t);
+			if(compare_tessellations(dist,"hilbert",ref,t,first)) bad++;
+		}
+
+		// Reorder the particles in memory
+		{
+			check_tessellation t(m);
+			con->sort_hilbert();
+			c_loop_all_2d vls(*con);
+			compute_cells(*con,vls,t);
+			if(compare_tessellations(dist,"sort_hilbert",ref,t,first)) bad++;
+		}
+		delete con;
+
+		{
+			// Move every seventh seed to a random position, and compare
+			// both with a fresh tessellation of the moved seeds and,
+			// after moving them back, with the reference
+			vector<double> w(v);
+			bench_random r(7);
+			for(i=0;i<m;i+=7) {w[2*i]=r.uniform()*width;w[2*i+1]=r.uniform()*height;}
+			check_tessellation mref(m),t1(m),t2(m);
+			reference_cells(w,mref);
+			vector<int> mfirst;
+			find_first_seeds(w,mfirst);
+			tracked_cells(v,w,t1,t2);
+			if(compare_tessellations(dist,"tracked_moved",mref,t1,mfirst)) bad++;
+			if(compare_tessellations(dist,"tracked",ref,t2,first)) bad++;
+		}
+		{
+			check_tessellation t(m);
+			tiled_cells(v,t);
+			if(compare_tessellations(dist,"tiled",ref,t,first)) bad++;
+		}
+		printf("%s,%d\n",dist,m);
+		fflush(stdout);
+	}
+	return bad;
+}
+
+const char *benchmarks[]={
+	"put","compute_all_cells","hilbert","sort_hilbert","metrics",
+	"put_concurrent","put_concurrent_sampled",
+	"find_voronoi_cell","find_voronoi_cell_shuffled","locator","locator_batch",
+#ifdef VORONOI_BENCH_OFX
+	"generate_ordered","generate_unordered","relax",
+#endif
+};
+
+/** Runs one benchmark case and prints its line of results. This is called in
+ * a child process. */
+void run_case(int b,int d,int n,double min_time) {
+	vector<double> v;
+	bench_result r;
+	distributions[d].make(n,v);
+	switch(b) {
+		case 0: bench_put(v,min_time,r);break;
+		case 1: bench_compute(v,min_time,r);break;
+		case 2: bench_hilbert(v,false,min_time,r);break;
+		case 3: bench_hilbert(v,true,min_time,r);break;
+		case 4: bench_metrics(v,min_time,r);break;
+		case 5: bench_put_concurrent(v,false,min_time,r);break;
+		case 6: bench_put_concurrent(v,true,min_time,r);break;
+		case 7: bench_locate(v,0,min_time,r);break;
+		case 8: bench_locate(v,1,min_time,r);break;
+		case 9: bench_locate(v,2,min_time,r);break;
+		case 10: bench_locate(v,3,min_time,r);break;
+#ifdef VORONOI_BENCH_OFX
+		case 11: bench_generate(v,true,min_time,r);break;
+		case 12: bench_generate(v,false,min_time,r);break;
+		case 13: bench_relax(v,min_time,r);
+#endif
+	}
+
+	// Work out the latency percentiles and the peak memory usage
+	sort(r.lat.begin(),r.lat.end());
+	size_t s=r.lat.size();
+	double p50=r.lat[s/2],p99=r.lat[std::min(s-1,size_t(0.99*s))];
+	struct rusage ru;
+	getrusage(RUSAGE_SELF,&ru);
+	printf("%s,%s,%d,%d,%.6g,%.6g,%.6g,%ld\n",benchmarks[b],distributions[d].name,
+	       int(v.size()/2),int(s),r.cells/r.time,p50,p99,ru.ru_maxrss);
+	fflush(stdout);
+}
+
+int main(int argc,char **argv) {
+	if(argc>1&&strcmp(argv[1],"check")==0) {
+		int bad=run_checks(argc>2?atoi(argv[2]):2000);
+		if(bad>0) fprintf(stderr,"voronoi_bench: %d checks failed\n",bad);
+		return bad>0?1:0;
+	}
+
+	int b,d,n,max_n=argc>1?atoi(argv[1]):1000000;
+	double min_time=argc>2?atof(argv[2]):0.5,budget=argc>3?atof(argv[3]):60;
+	const int nb=sizeof(benchmarks)/sizeof(*benchmarks);
+	const int nd=sizeof(distributions)/sizeof(*distributions);
+
+	puts("benchmark,distribution,seeds,samples,cells_per_s,p50_us,p99_us,peak_rss_kb");
+	fflush(stdout);
+	for(b=0;b<nb;b++) for(d=0;d<nd;d++) for(n=100;n<=max_n;n*=10) {
+		bench_clock::time_point t0=bench_clock::now();
+		pid_t pid=fork();
+		if(pid==0) {
+			run_case(b,d,n,min_time);
+			_exit(0);
+		}
+		int status;
+		waitpid(pid,&status,0);
+		if(!WIFEXITED(status)||WEXITSTATUS(status)!=0)
+			fprintf(stderr,"voronoi_bench: %s/%s at %d seeds failed\n",benchmarks[b],distributions[d].name,n);
+		if(seconds_since(t0)>budget) {
+			fprintf(stderr,"voronoi_bench: skipping larger %s/%s cases\n",benchmarks[b],distributions[d].name);
+			break;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,339 @@
+#include "frameSource.h"
+
+//--------------------------------------------------------------
+void frameSource::setRealtime(bool _realtime, float _fps)
+{
+	realtime = _realtime;
+	fps = _fps;
+	nextFrameTime = 0;
+}
+
+//--------------------------------------------------------------
+bool frameSource::isRealtime() const
+{
+	return realtime;
+}
+
+//--------------------------------------------------------------
+bool frameSource::nextFrameDue()
+{
+	if (!realtime) {
+		return true;
+	}
+	uint64_t now = ofGetElapsedTimeMicros();
+	if (now < nextFrameTime) {
+		return false;
+	}
+	// Frames that are late are dropped rather than caught up on
+	uint64_t period = 1000000 / fps;
+	nextFrameTime += period;
+	if (nextFrameTime <= now) {
+		nextFrameTime = now + period;
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+bool grabberFrameSource::setup(int width, int height)
+{
+	// The frames are only read on the analyzer's thread, so the grabber
+	// must not upload them to a texture, which needs the GL context
+	cam.setUseTexture(false);
+	return cam.setup(width, height);
+}
+
+//--------------------------------------------------------------
+bool grabberFrameSource::update()
+{
+	cam.update();
+	return cam.isFrameNew();
+}
+
+//--------------------------------------------------------------
+const unsigned char * grabberFrameSource::getPixels()
+{
+	return cam.getPixels().getData();
+}
+
+//--------------------------------------------------------------
+int grabberFrameSource::getWidth() const
+{
+	return cam.getWidth();
+}
+
+//--------------------------------------------------------------
+int grabberFrameSource::getHeight() const
+{
+	return cam.getHeight();
+}
+
+//--------------------------------------------------------------
+rawFrameSource::rawFrameSource(const string& _path)
+	: path(_path)
+{
+}
+
+//--------------------------------------------------------------
+bool rawFrameSource::setup(int _width, int _height)
+{
+	width = _width;
+	height = _height;
+	pixels.assign(width * height * 3, 0);
+	file.open(ofToDataPath(path, true).c_str(), ios::binary);
+	if (!file) {
+		ofLogError("rawFrameSource") << "can't open " << path;
+		return false;
+	}
+	file.seekg(0, ios::end);
+	if (file.tellg() < (streamoff)pixels.size()) {
+		ofLogError("rawFrameSource") << path << " doesn't hold a " << width << "x" << height << " RGB frame";
+		file.close();
+		return false;
+	}
+	file.seekg(0);
+	return true;
+}
+
+//--------------------------------------------------------------
+bool rawFrameSource::update()
+{
+	if (!file.is_open() || !nextFrameDue()) {
+		return false;
+	}
+	file.read((char *)pixels.data(), pixels.size());
+	if (file.gcount() < (streamsize)pixels.size()) {
+		// Start over, dropping a partial frame at the end of the file
+		file.clear();
+		file.seekg(0);
+		file.read((char *)pixels.data(), pixels.size());
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+const unsigned char * rawFrameSource::getPixels()
+{
+	return pixels.data();
+}
+
+//--------------------------------------------------------------
+int rawFrameSource::getWidth() const
+{
+	return width;
+}
+
+//--------------------------------------------------------------
+int rawFrameSource::getHeight() const
+{
+	return height;
+}
+
+//--------------------------------------------------------------
+videoFrameSource::videoFrameSource(const string& _path)
+	: path(_path)
+{
+}
+
+//--------------------------------------------------------------
+bool videoFrameSource::setup(int width, int height)
+{
+	player.setUseTexture(false);
+	player.setPixelFormat(OF_PIXELS_RGB);
+	if (!player.load(path)) {
+		ofLogError("videoFrameSource") << "can't load " << path;
+		return false;
+	}
+	player.setLoopState(OF_LOOP_NORMAL);
+	player.setVolume(0);
+	player.play();
+	// Out of real time the frames are stepped through one by one
+	if (!realtime) {
+		player.setPaused(true);
+	}
+	return true;
+}
+
+//--------------------------------------------------------------
+bool videoFrameSource::update()
+{
+	if (!realtime) {
+		if (player.getCurrentFrame() >= player.getTotalNumFrames() - 1) {
+			player.firstFrame();
+		}
+		else {
+			player.nextFrame();
+		}
+	}
+	player.update();
+	return player.isFrameNew();
+}
+
+//--------------------------------------------------------------
+const unsigned char * videoFrameSource::getPixels()
+{
+	return player.getPixels().getData();
+}
+
+//--------------------------------------------------------------
+int videoFrameSource::getWidth() const
+{
+	return player.getWidth();
+}
+
+//--------------------------------------------------------------
+int videoFrameSource::getHeight() const
+{
+	return player.getHeight();
+}
+
+//--------------------------------------------------------------
+// xorshift32, so the generated frames are the same on every platform
+static unsigned int nextRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+//--------------------------------------------------------------
+static float randomFloat(unsigned int& state, float low, float high)
+{
+	return low + (high - low) * (nextRandom(state) & 0xffffff) / float(0x1000000);
+}
+
+//--------------------------------------------------------------
+syntheticFrameSource::syntheticFrameSource(unsigned int _seed, int _blobCount)
+	: seed(_seed)
+	, blobCount(_blobCount)
+{
+}
+
+//--------------------------------------------------------------
+bool syntheticFrameSource::setup(int _width, int _height)
+{
+	width = _width;
+	height = _height;
+	frame = 0;
+	unsigned int state = seed * 2654435761u + 1;
+
+	// A dim gradient with some fixed texture, like a room
+	background.resize(width * height * 3);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			int level = 50 + 40 * x / width + 20 * y / height + (nextRandom(state) & 15);
+			unsigned char * pixel = &background[(y * width + x) * 3];
+			pixel[0] = level;
+			pixel[1] = level;
+			pixel[2] = level + 10;
+		}
+	}
+
+	// Sensor noise, read from a random offset each frame. The table size
+	// is not a multiple of the row length, so the pattern does not line up
+	// from one row to the next.
+	noise.resize(65536 + 4093);
+	for (auto& value : noise) {
+		value = nextRandom(state) & 7;
+	}
+
+	blobs.resize(blobCount);
+	for (auto& blob : blobs) {
+		blob.speedX = randomFloat(state, 0.3f, 1.2f);
+		blob.speedY = randomFloat(state, 0.3f, 1.2f);
+		blob.phaseX = randomFloat(state, 0, TWO_PI);
+		blob.phaseY = randomFloat(state, 0, TWO_PI);
+		blob.radius = randomFloat(state, 0.06f, 0.14f) * height;
+		for (auto& channel : blob.color) {
+			channel = 180 + (nextRandom(state) & 63);
+		}
+	}
+
+	pixels.resize(background.size());
+	return width > 0 && height > 0;
+}
+
+//--------------------------------------------------------------
+bool syntheticFrameSource::update()
+{
+	if (!nextFrameDue()) {
+		return false;
+	}
+	render();
+	++frame;
+	return true;
+}
+
+//--------------------------------------------------------------
+void syntheticFrameSource::render()
+{
+	unsigned int state = (seed ^ (unsigned int)frame) * 2654435761u + 1;
+	int j = nextRandom(state) & 0xffff;
+	for (int i = 0; i < pixels.size(); ) {
+		int run = min(pixels.size() - i, noise.size() - j);
+		for (int k = 0; k < run; ++k) {
+			pixels[i + k] = background[i + k] + noise[j + k];
+		}
+		i += run;
+		j = 0;
+	}
+
+	// The blobs follow Lissajous curves, with the time taken from the
+	// frame number rather than the clock
+	float time = frame / 30.0f;
+	for (auto& blob : blobs) {
+		float centerX = width * (0.5f + 0.35f * sin(blob.speedX * time + blob.phaseX));
+		float centerY = height * (0.5f + 0.35f * sin(blob.speedY * time + blob.phaseY));
+		int top = max(0, int(centerY - blob.radius));
+		int bottom = min(height - 1, int(centerY + blob.radius));
+		for (int y = top; y <= bottom; ++y) {
+			float dy = y - centerY;
+			float halfWidth = sqrt(max(0.0f, blob.radius * blob.radius - dy * dy));
+			int left = max(0, int(centerX - halfWidth));
+			int right = min(width - 1, int(centerX + halfWidth));
+			for (int x = left; x <= right; ++x) {
+				unsigned char * pixel = &pixels[(y * width + x) * 3];
+				pixel[0] = blob.color[0];
+				pixel[1] = blob.color[1];
+				pixel[2] = blob.color[2];
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------
+const unsigned char * syntheticFrameSource::getPixels()
+{
+	return pixels.data();
+}
+
+//--------------------------------------------------------------
+int syntheticFrameSource::getWidth() const
+{
+	return width;
+}
+
+//--------------------------------------------------------------
+int syntheticFrameSource::getHeight() const
+{
+	return height;
+}
+
+//--------------------------------------------------------------
+std::unique_ptr<frameSource> createFrameSource(const string& name)
+{
+	if (name == "camera") {
+		return std::unique_ptr<frameSource>(new grabberFrameSource());
+	}
+	if (name == "synthetic") {
+		return std::unique_ptr<frameSource>(new syntheticFrameSource());
+	}
+	if (name.compare(0, 10, "synthetic:") == 0) {
+		return std::unique_ptr<frameSource>(new syntheticFrameSource(ofToInt(name.substr(10))));
+	}
+	string extension = ofToLower(ofFilePath::getFileExt(name));
+	if (extension == "rgb" || extension == "raw") {
+		return std::unique_ptr<frameSource>(new rawFrameSource(name));
+	}
+	return std::unique_ptr<frameSource>(new videoFrameSource(name));
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <fstream>
+#include <memory>
+
+// Where the motion detection gets its frames from. Apart from the camera,
+// frames can be replayed from a file or generated, so the app can run and
+// be profiled on machines without a camera. The sources are used from the
+// analyzer's thread and never touch GL.
+class frameSource {
+public:
+	virtual ~frameSource() {}
+
+	// Opens the source, asking for frames of the given size. Sources that
+	// cannot scale their frames, like video files, may deliver another size.
+	virtual bool setup(int width, int height) = 0;
+	// Moves on to the next frame, returning whether there is a new one
+	virtual bool update() = 0;
+	// The current frame as packed RGB, getWidth() * getHeight() * 3 bytes
+	virtual const unsigned char * getPixels() = 0;
+	virtual int getWidth() const = 0;
+	virtual int getHeight() const = 0;
+
+	// Replayed and generated frames are delivered at fps frames per second
+	// in real time. Otherwise every update() gives a new frame, so the
+	// frames are processed as fast as possible. The camera always runs at
+	// its own rate. Call before setup().
+	void setRealtime(bool realtime, float fps = 30);
+	bool isRealtime() const;
+
+protected:
+	// Whether the next frame is due, always true when not in real time
+	bool nextFrameDue();
+
+	bool realtime = true;
+	float fps = 30;
+	uint64_t nextFrameTime = 0;
+};
+
+// Frames from a camera
+class grabberFrameSource : public frameSource {
+public:
+	bool setup(int width, int height);
+	bool update();
+	const unsigned char * getPixels();
+	int getWidth() const;
+	int getHeight() const;
+
+private:
+	ofVideoGrabber cam;
+};
+
+// Frames from a file of raw packed RGB frames of the requested size,
+// one after the other without headers, as written by
+// ffmpeg -i clip.mp4 -s 1280x720 -pix_fmt rgb24 -f rawvideo clip.rgb
+// The file is replayed in a loop.
+class rawFrameSource : public frameSource {
+public:
+	rawFrameSource(const string& path);
+	bool setup(int width, int height);
+	bool update();
+	const unsigned char * getPixels();
+	int getWidth() const;
+	int getHeight() const;
+
+private:
+	string path;
+	ifstream file;
+	int width = 0;
+	int height = 0;
+	vector<unsigned char> pixels;
+};
+
+// Frames from a video file, replayed in a loop at the video's own size
+class videoFrameSource : public frameSource {
+public:
+	videoFrameSource(const string& path);
+	bool setup(int width, int height);
+	bool update();
+	const unsigned char * getPixels();
+	int getWidth() const;
+	int getHeight() const;
+
+private:
+	string path;
+	ofVideoPlayer player;
+};
+
+// Generated frames of bright blobs moving over a noisy background. The
+// frames only depend on the seed and the frame number, so runs can be
+// compared with each other.
+class syntheticFrameSource : public frameSource {
+public:
+	syntheticFrameSource(unsigned int seed = 1, int blobCount = 3);
+	bool setup(int width, int height);
+	bool update();
+	const unsigned char * getPixels();
+	int getWidth() const;
+	int getHeight() const;
+
+private:
+	struct blob {
+		float speedX, speedY;
+		float phaseX, phaseY;
+		float radius;
+		unsigned char color[3];
+	};
+
+	void render();
+
+	unsigned int seed;
+	int blobCount;
+	int width = 0;
+	int height = 0;
+	uint64_t frame = 0;
+	vector<blob> blobs;
+	vector<unsigned char> background;
+	vector<unsigned char> noise;
+	vector<unsigned char> pixels;
+};
+
+// Creates the source named by a command line argument: "camera",
+// "synthetic" or "synthetic:<seed>", or the path of a video file or of a
+// raw file ending in .rgb or .raw
+std::unique_ptr<frameSource> createFrameSource(const string& name);
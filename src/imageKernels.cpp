@@ -0,0 +1,515 @@
+#include "imageKernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IMAGE_KERNELS_NEON 1
+#elif defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define IMAGE_KERNELS_SSSE3 1
+#endif
+
+// Without SSSE3 enabled for the whole build, GCC and Clang only allow the
+// intrinsics in functions marked with this, which are called only if the
+// CPU supports them
+#if IMAGE_KERNELS_SSSE3 && defined(__GNUC__) && !defined(__SSSE3__)
+#define IMAGE_KERNELS_SSSE3_TARGET __attribute__((target("ssse3")))
+#else
+#define IMAGE_KERNELS_SSSE3_TARGET
+#endif
+
+namespace {
+
+//--------------------------------------------------------------
+// Copies pixels [0, count) of a row to dst in reverse order
+inline void mirrorPixels(const unsigned char * src, unsigned char * dst, int count)
+{
+	const unsigned char * s = src + 3 * (count - 1);
+	for (int x = 0; x < count; ++x, s -= 3, dst += 3) {
+		dst[0] = s[0];
+		dst[1] = s[1];
+		dst[2] = s[2];
+	}
+}
+
+//--------------------------------------------------------------
+// Grey value of an RGB pixel, in the 14-bit fixed point that OpenCV uses,
+// so that the result matches cvCvtColor() exactly
+inline unsigned char rgbToGray(const unsigned char * p)
+{
+	return (unsigned char)((p[0] * 4899 + p[1] * 9617 + p[2] * 1868 + (1 << 13)) >> 14);
+}
+
+#if IMAGE_KERNELS_SSSE3
+//--------------------------------------------------------------
+bool hasSsse3()
+{
+#if defined(__SSSE3__)
+	return true;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 9)) != 0;
+#else
+	return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+const bool useSsse3 = hasSsse3();
+
+//--------------------------------------------------------------
+// Reverses the order of the 16 pixels held in 48 bytes. Each output
+// register gathers its bytes from the two or three input registers they
+// come from, with the bytes from the other registers zeroed by the masks.
+IMAGE_KERNELS_SSSE3_TARGET inline void mirror16(const unsigned char * src, unsigned char * dst)
+{
+	const __m128i m01 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 14);
+	const __m128i m02 = _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, -1);
+	const __m128i m10 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, -1);
+	const __m128i m11 = _mm_setr_epi8(15, -1, 11, 12, 13, 8, 9, 10, 5, 6, 7, 2, 3, 4, -1, 0);
+	const __m128i m12 = _mm_setr_epi8(-1, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i m20 = _mm_setr_epi8(-1, 12, 13, 14, 9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2);
+	const __m128i m21 = _mm_setr_epi8(1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	__m128i a = _mm_loadu_si128((const __m128i *)src);
+	__m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+	__m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+	__m128i d0 = _mm_or_si128(_mm_shuffle_epi8(c, m02), _mm_shuffle_epi8(b, m01));
+	__m128i d1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, m11), _mm_shuffle_epi8(a, m10)), _mm_shuffle_epi8(c, m12));
+	__m128i d2 = _mm_or_si128(_mm_shuffle_epi8(a, m20), _mm_shuffle_epi8(b, m21));
+	_mm_storeu_si128((__m128i *)dst, d0);
+	_mm_storeu_si128((__m128i *)(dst + 16), d1);
+	_mm_storeu_si128((__m128i *)(dst + 32), d2);
+}
+
+//--------------------------------------------------------------
+// Mirrors the first width - width % 16 output pixels of a row and
+// returns how many that is
+IMAGE_KERNELS_SSSE3_TARGET int mirrorRow16(const unsigned char * src, unsigned char * dst, int width)
+{
+	// Output pixels [x, x + 16) come from input pixels
+	// [width - x - 16, width - x)
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		mirror16(src + 3 * (width - x - 16), dst + 3 * x);
+	}
+	return x;
+}
+
+//--------------------------------------------------------------
+// Grey values of the 4 pixels in bytes 0 to 11, as 32-bit integers. The
+// channels are spread into 16-bit pairs (r, g) and (b, 1), so that each
+// multiply-add gives two of the terms of rgbToGray(), rounding included.
+IMAGE_KERNELS_SSSE3_TARGET inline __m128i gray4(__m128i v)
+{
+	const __m128i rg = _mm_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1, 9, -1, 10, -1);
+	const __m128i b = _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+	const __m128i one = _mm_set1_epi32(1 << 16);
+	const __m128i wrg = _mm_set1_epi32((9617 << 16) | 4899);
+	const __m128i wb = _mm_set1_epi32(((1 << 13) << 16) | 1868);
+	__m128i sum = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi8(v, rg), wrg),
+		_mm_madd_epi16(_mm_or_si128(_mm_shuffle_epi8(v, b), one), wb));
+	return _mm_srli_epi32(sum, 14);
+}
+
+//--------------------------------------------------------------
+// Grey values of the 16 pixels in 48 bytes, in reverse order
+IMAGE_KERNELS_SSSE3_TARGET inline __m128i mirrorGray16(const unsigned char * src)
+{
+	const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	__m128i a = _mm_loadu_si128((const __m128i *)src);
+	__m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+	__m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+	__m128i g01 = _mm_packs_epi32(gray4(a), gray4(_mm_alignr_epi8(b, a, 12)));
+	__m128i g23 = _mm_packs_epi32(gray4(_mm_alignr_epi8(c, b, 8)), gray4(_mm_srli_si128(c, 4)));
+	return _mm_shuffle_epi8(_mm_packus_epi16(g01, g23), reverse);
+}
+
+//--------------------------------------------------------------
+// 255 where |a - b| > threshold, given as threshold + 1 clamped to
+// [0, 255] and a mask that is zero if no difference can be above it
+IMAGE_KERNELS_SSSE3_TARGET inline __m128i thresholdDiff16(__m128i a, __m128i b, __m128i above, __m128i possible)
+{
+	__m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+	return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(d, above), d), possible);
+}
+
+//--------------------------------------------------------------
+// Converts the first width - width % 16 output pixels of a row to grey,
+// mirroring it, and returns how many that is
+IMAGE_KERNELS_SSSE3_TARGET int mirrorGrayRow16(const unsigned char * src, unsigned char * dst, int width)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		_mm_storeu_si128((__m128i *)(dst + x), mirrorGray16(src + 3 * (width - x - 16)));
+	}
+	return x;
+}
+
+//--------------------------------------------------------------
+// Does the first width - width % 16 pixels of addRow() and returns how
+// many that is
+IMAGE_KERNELS_SSSE3_TARGET int addRow16(const unsigned char * row, unsigned short * sums, int width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i r = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i lo = _mm_loadu_si128((const __m128i *)(sums + x));
+		__m128i hi = _mm_loadu_si128((const __m128i *)(sums + x + 8));
+		_mm_storeu_si128((__m128i *)(sums + x), _mm_add_epi16(lo, _mm_unpacklo_epi8(r, zero)));
+		_mm_storeu_si128((__m128i *)(sums + x + 8), _mm_add_epi16(hi, _mm_unpackhi_epi8(r, zero)));
+	}
+	return x;
+}
+
+//--------------------------------------------------------------
+// Does the first width - width % 16 pixels of diffRow() and returns how
+// many that is
+IMAGE_KERNELS_SSSE3_TARGET int diffRow16(const unsigned char * row, int width, unsigned char * gray, const unsigned char * background,
+	unsigned char * motion, unsigned char * presence, int threshold, int & motionCount, int & presenceCount)
+{
+	// The comparison is d >= threshold + 1, and a difference is never
+	// above a threshold of 255
+	const __m128i above = _mm_set1_epi8((char)(threshold < 0 ? 0 : threshold < 255 ? threshold + 1 : 255));
+	const __m128i possible = _mm_set1_epi8(threshold < 255 ? -1 : 0);
+	const __m128i ones = _mm_set1_epi8(1);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i motionSum = zero, presenceSum = zero;
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i g = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i old = _mm_loadu_si128((const __m128i *)(gray + x));
+		__m128i bg = _mm_loadu_si128((const __m128i *)(background + x));
+		__m128i m = thresholdDiff16(old, g, above, possible);
+		__m128i p = thresholdDiff16(bg, g, above, possible);
+		_mm_storeu_si128((__m128i *)(gray + x), g);
+		_mm_storeu_si128((__m128i *)(motion + x), m);
+		_mm_storeu_si128((__m128i *)(presence + x), p);
+		motionSum = _mm_add_epi64(motionSum, _mm_sad_epu8(_mm_and_si128(m, ones), zero));
+		presenceSum = _mm_add_epi64(presenceSum, _mm_sad_epu8(_mm_and_si128(p, ones), zero));
+	}
+	motionCount += _mm_cvtsi128_si32(motionSum) + _mm_cvtsi128_si32(_mm_srli_si128(motionSum, 8));
+	presenceCount += _mm_cvtsi128_si32(presenceSum) + _mm_cvtsi128_si32(_mm_srli_si128(presenceSum, 8));
+	return x;
+}
+#elif IMAGE_KERNELS_NEON
+//--------------------------------------------------------------
+// Reverses the order of the 16 pixels held in 48 bytes. The load splits
+// the channels into separate registers, so each one is a plain reversal.
+inline uint8x16_t reverse16(uint8x16_t v)
+{
+	v = vrev64q_u8(v);
+	return vextq_u8(v, v, 8);
+}
+
+inline void mirror16(const unsigned char * src, unsigned char * dst)
+{
+	uint8x16x3_t v = vld3q_u8(src);
+	v.val[0] = reverse16(v.val[0]);
+	v.val[1] = reverse16(v.val[1]);
+	v.val[2] = reverse16(v.val[2]);
+	vst3q_u8(dst, v);
+}
+
+//--------------------------------------------------------------
+// Mirrors the first width - width % 16 output pixels of a row and
+// returns how many that is
+int mirrorRow16(const unsigned char * src, unsigned char * dst, int width)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		mirror16(src + 3 * (width - x - 16), dst + 3 * x);
+	}
+	return x;
+}
+
+//--------------------------------------------------------------
+// Grey values of 8 pixels whose channels are in the low or high halves of
+// r, g and b. The rounding narrowing shift does the rounding of rgbToGray().
+inline uint16x8_t gray8(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	uint16x8_t r16 = vmovl_u8(r), g16 = vmovl_u8(g), b16 = vmovl_u8(b);
+	uint32x4_t lo = vmull_n_u16(vget_low_u16(r16), 4899);
+	lo = vmlal_n_u16(lo, vget_low_u16(g16), 9617);
+	lo = vmlal_n_u16(lo, vget_low_u16(b16), 1868);
+	uint32x4_t hi = vmull_n_u16(vget_high_u16(r16), 4899);
+	hi = vmlal_n_u16(hi, vget_high_u16(g16), 9617);
+	hi = vmlal_n_u16(hi, vget_high_u16(b16), 1868);
+	return vcombine_u16(vrshrn_n_u32(lo, 14), vrshrn_n_u32(hi, 14));
+}
+
+//--------------------------------------------------------------
+// Grey values of the 16 pixels in 48 bytes, in reverse order
+inline uint8x16_t mirrorGray16(const unsigned char * src)
+{
+	uint8x16x3_t v = vld3q_u8(src);
+	uint8x8_t lo = vmovn_u16(gray8(vget_low_u8(v.val[0]), vget_low_u8(v.val[1]), vget_low_u8(v.val[2])));
+	uint8x8_t hi = vmovn_u16(gray8(vget_high_u8(v.val[0]), vget_high_u8(v.val[1]), vget_high_u8(v.val[2])));
+	return reverse16(vcombine_u8(lo, hi));
+}
+
+//--------------------------------------------------------------
+// Adds up the bytes of a vector
+inline int sumBytes(uint8x16_t v)
+{
+	uint64x2_t s = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(v)));
+	return (int)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+}
+
+//--------------------------------------------------------------
+// Converts the first width - width % 16 output pixels of a row to grey,
+// mirroring it, and returns how many that is
+int mirrorGrayRow16(const unsigned char * src, unsigned char * dst, int width)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		vst1q_u8(dst + x, mirrorGray16(src + 3 * (width - x - 16)));
+	}
+	return x;
+}
+
+//--------------------------------------------------------------
+// Does the first width - width % 16 pixels of addRow() and returns how
+// many that is
+int addRow16(const unsigned char * row, unsigned short * sums, int width)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16_t r = vld1q_u8(row + x);
+		vst1q_u16(sums + x, vaddw_u8(vld1q_u16(sums + x), vget_low_u8(r)));
+		vst1q_u16(sums + x + 8, vaddw_u8(vld1q_u16(sums + x + 8), vget_high_u8(r)));
+	}
+	return x;
+}
+
+//--------------------------------------------------------------
+// Does the first width - width % 16 pixels of diffRow() and returns how
+// many that is
+int diffRow16(const unsigned char * row, int width, unsigned char * gray, const unsigned char * background,
+	unsigned char * motion, unsigned char * presence, int threshold, int & motionCount, int & presenceCount)
+{
+	// A difference is never above a threshold of 255, and always above
+	// a negative one
+	const uint8x16_t t = vdupq_n_u8((uint8_t)(threshold < 0 ? 0 : threshold < 255 ? threshold : 255));
+	const uint8x16_t always = vdupq_n_u8(threshold < 0 ? 255 : 0);
+	const uint8x16_t ones = vdupq_n_u8(1);
+	int x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16_t g = vld1q_u8(row + x);
+		uint8x16_t old = vld1q_u8(gray + x);
+		uint8x16_t bg = vld1q_u8(background + x);
+		uint8x16_t m = vorrq_u8(vcgtq_u8(vabdq_u8(old, g), t), always);
+		uint8x16_t p = vorrq_u8(vcgtq_u8(vabdq_u8(bg, g), t), always);
+		vst1q_u8(gray + x, g);
+		vst1q_u8(motion + x, m);
+		vst1q_u8(presence + x, p);
+		motionCount += sumBytes(vandq_u8(m, ones));
+		presenceCount += sumBytes(vandq_u8(p, ones));
+	}
+	return x;
+}
+#endif
+
+//--------------------------------------------------------------
+// Converts a row to grey, mirroring it
+void mirrorGrayRow(const unsigned char * src, unsigned char * dst, int width)
+{
+	int x = 0;
+#if IMAGE_KERNELS_SSSE3
+	if (useSsse3) {
+		x = mirrorGrayRow16(src, dst, width);
+	}
+#elif IMAGE_KERNELS_NEON
+	x = mirrorGrayRow16(src, dst, width);
+#endif
+	const unsigned char * s = src + 3 * (width - 1 - x);
+	for (; x < width; ++x, s -= 3) {
+		dst[x] = rgbToGray(s);
+	}
+}
+
+//--------------------------------------------------------------
+// Adds a row of grey values to a row of sums
+void addRow(const unsigned char * row, unsigned short * sums, int width)
+{
+	int x = 0;
+#if IMAGE_KERNELS_SSSE3
+	if (useSsse3) {
+		x = addRow16(row, sums, width);
+	}
+#elif IMAGE_KERNELS_NEON
+	x = addRow16(row, sums, width);
+#endif
+	for (; x < width; ++x) {
+		sums[x] += row[x];
+	}
+}
+
+//--------------------------------------------------------------
+// Averages each group of scale column sums of scale rows, rounding to
+// nearest. The sums of a block are below 2^16 for scales up to 16, and for
+// those dividing by the area is the same as multiplying by the rounded up
+// reciprocal and shifting by 32, which is much faster.
+void averageBlocks(const unsigned short * columns, unsigned char * out, int outWidth, int scale)
+{
+	const unsigned int area = scale * scale;
+	const unsigned long long reciprocal = ((1ULL << 32) + area - 1) / area;
+	for (int x = 0; x < outWidth; ++x) {
+		unsigned int sum = area / 2;
+		for (int j = 0; j < scale; ++j, ++columns) {
+			sum += *columns;
+		}
+		out[x] = (unsigned char)((sum * reciprocal) >> 32);
+	}
+}
+
+// The same for the common scales, where the compiler can unroll the sums
+// and replace the division with a shift
+template<int scale>
+void averageBlocks(const unsigned short * columns, unsigned char * out, int outWidth)
+{
+	const unsigned int area = scale * scale;
+	for (int x = 0; x < outWidth; ++x, columns += scale) {
+		unsigned int sum = area / 2;
+		for (int j = 0; j < scale; ++j) {
+			sum += columns[j];
+		}
+		out[x] = (unsigned char)(sum / area);
+	}
+}
+
+//--------------------------------------------------------------
+// Replaces a row of grey values with a new one, thresholding their
+// differences from the old values and from the background
+void diffRow(const unsigned char * row, int width, unsigned char * gray, const unsigned char * background,
+	unsigned char * motion, unsigned char * presence, int threshold, int & motionCount, int & presenceCount)
+{
+	int x = 0;
+#if IMAGE_KERNELS_SSSE3
+	if (useSsse3) {
+		x = diffRow16(row, width, gray, background, motion, presence, threshold, motionCount, presenceCount);
+	}
+#elif IMAGE_KERNELS_NEON
+	x = diffRow16(row, width, gray, background, motion, presence, threshold, motionCount, presenceCount);
+#endif
+	for (; x < width; ++x) {
+		int g = row[x];
+		bool m = abs(g - gray[x]) > threshold;
+		bool p = abs(g - background[x]) > threshold;
+		gray[x] = (unsigned char)g;
+		motion[x] = m ? 255 : 0;
+		presence[x] = p ? 255 : 0;
+		motionCount += m;
+		presenceCount += p;
+	}
+}
+
+//--------------------------------------------------------------
+void mirrorRow(const unsigned char * src, unsigned char * dst, int width)
+{
+	int x = 0;
+#if IMAGE_KERNELS_SSSE3
+	if (useSsse3) {
+		x = mirrorRow16(src, dst, width);
+	}
+#elif IMAGE_KERNELS_NEON
+	x = mirrorRow16(src, dst, width);
+#endif
+	mirrorPixels(src, dst + 3 * x, width - x);
+}
+
+}
+
+//--------------------------------------------------------------
+const char * imageKernelsIsa()
+{
+#if IMAGE_KERNELS_SSSE3
+	return useSsse3 ? "ssse3" : "scalar";
+#elif IMAGE_KERNELS_NEON
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
+
+//--------------------------------------------------------------
+void mirrorRgb(const unsigned char * src, unsigned char * dst, int width, int height, int threads)
+{
+	const int stride = width * 3;
+#pragma omp parallel for num_threads(threads) if(threads > 1) schedule(static)
+	for (int y = 0; y < height; ++y) {
+		mirrorRow(src + y * stride, dst + y * stride, width);
+	}
+}
+
+//--------------------------------------------------------------
+void mirrorRgbScalar(const unsigned char * src, unsigned char * dst, int width, int height)
+{
+	const int stride = width * 3;
+	for (int y = 0; y < height; ++y) {
+		mirrorPixels(src + y * stride, dst + y * stride, width);
+	}
+}
+
+//--------------------------------------------------------------
+void mirrorRgbToGray(const unsigned char * src, unsigned char * dst, int width, int height, int dstStride, int threads)
+{
+	const int stride = width * 3;
+#pragma omp parallel for num_threads(threads) if(threads > 1) schedule(static)
+	for (int y = 0; y < height; ++y) {
+		mirrorGrayRow(src + y * stride, dst + y * dstStride, width);
+	}
+}
+
+//--------------------------------------------------------------
+void updateMotionMasks(const unsigned char * src, int width, int height, int scale, unsigned char * gray, const unsigned char * background,
+	unsigned char * motion, unsigned char * presence, int stride, int threshold, int & motionCount, int & presenceCount, int threads)
+{
+	const int srcStride = width * 3;
+	const int outWidth = width / scale, outHeight = height / scale;
+	int motionSum = 0, presenceSum = 0;
+#pragma omp parallel num_threads(threads) if(threads > 1) reduction(+:motionSum, presenceSum)
+	{
+		// Each grey row is made in a small buffer that stays in the
+		// cache, so the frame is still only read once
+		vector<unsigned char> row(width), out(outWidth);
+		vector<unsigned short> columns(scale > 1 ? width : 0);
+#pragma omp for schedule(static)
+		for (int y = 0; y < outHeight; ++y) {
+			const unsigned char * s = src + y * scale * srcStride;
+			if (scale == 1) {
+				mirrorGrayRow(s, &out[0], width);
+			}
+			else {
+				// Add up the rows first, then average the column sums
+				// over each block, rounding to nearest
+				fill(columns.begin(), columns.end(), 0);
+				for (int k = 0; k < scale; ++k) {
+					mirrorGrayRow(s + k * srcStride, &row[0], width);
+					addRow(&row[0], &columns[0], width);
+				}
+				if (scale == 2) {
+					averageBlocks<2>(&columns[0], &out[0], outWidth);
+				}
+				else if (scale == 4) {
+					averageBlocks<4>(&columns[0], &out[0], outWidth);
+				}
+				else {
+					averageBlocks(&columns[0], &out[0], outWidth, scale);
+				}
+			}
+			int offset = y * stride;
+			diffRow(&out[0], outWidth, gray + offset, background + offset, motion + offset, presence + offset, threshold, motionSum, presenceSum);
+		}
+	}
+	motionCount = motionSum;
+	presenceCount = presenceSum;
+}
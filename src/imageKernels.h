@@ -0,0 +1,35 @@
+#pragma once
+
+// Pixel kernels for the camera frames. Each one has a plain C++ version,
+// which is always compiled, and a SIMD version that is used on ARM (NEON)
+// and on x86 CPUs that support SSSE3, which is checked at startup.
+
+// Name of the instruction set used by the kernels, for benchmarks and logs
+const char * imageKernelsIsa();
+
+// Mirrors a packed RGB image horizontally, writing into dst, which must not
+// overlap src. With threads > 1 and OpenMP enabled the rows are split into
+// that many bands.
+void mirrorRgb(const unsigned char * src, unsigned char * dst, int width, int height, int threads = 1);
+
+// Plain C++ version of mirrorRgb(), for checking the SIMD version
+void mirrorRgbScalar(const unsigned char * src, unsigned char * dst, int width, int height);
+
+// Converts a packed RGB image to grey with the weights that OpenCV uses for
+// CV_RGB2GRAY, mirroring it horizontally on the way. The rows of dst are
+// dstStride bytes apart, so it can point straight into an IplImage.
+void mirrorRgbToGray(const unsigned char * src, unsigned char * dst, int width, int height, int dstStride, int threads = 1);
+
+// The motion detection for a new camera frame in a single pass. The frame
+// is mirrored and converted to grey as by mirrorRgbToGray(), then shrunk
+// by an integer scale, averaging the grey values over each block of
+// scale x scale pixels. The result replaces the previous grey frame in
+// gray, which like the other grey images has width / scale columns and
+// height / scale rows, stride bytes apart. The difference between the new
+// and the previous grey values is thresholded into motion, and the
+// difference between the new values and background into presence, both
+// set to 255 where the difference is above threshold and 0 elsewhere, as
+// by cvThreshold() with CV_THRESH_BINARY. The counts of set pixels in each
+// mask are returned.
+void updateMotionMasks(const unsigned char * src, int width, int height, int scale, unsigned char * gray, const unsigned char * background,
+	unsigned char * motion, unsigned char * presence, int stride, int threshold, int & motionCount, int & presenceCount, int threads = 1);
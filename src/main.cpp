@@ -1,13 +1,57 @@
 #include "ofMain.h"
+#include "ofAppNoWindow.h"
 #include "ofApp.h"
 
 //========================================================================
-int main( ){
-	ofSetupOpenGL(1920, 1080, OF_WINDOW);			// <-------- setup the GL context
+int main(int argc, char *argv[]){
+	// The frames come from the camera, unless a source is given on the
+	// command line, see createFrameSource(). With --fast, replayed and
+	// generated frames are processed as fast as possible. --headless
+	// <frames> profiles that many frames without a window. --csv <path>
+	// logs the timings of each frame.
+	string sourceName = "camera";
+	bool fast = false;
+	int headlessFrames = 0;
+	string csvPath;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (arg == "--fast") {
+			fast = true;
+		}
+		else if (arg == "--headless" && i + 1 < argc) {
+			headlessFrames = max(1, ofToInt(argv[++i]));
+		}
+		else if (arg == "--csv" && i + 1 < argc) {
+			csvPath = argv[++i];
+		}
+		else {
+			sourceName = arg;
+		}
+	}
+
+	ofAppNoWindow noWindow;
+	if (headlessFrames > 0) {
+		ofSetLogLevel(OF_LOG_WARNING);
+		ofSetupOpenGL(&noWindow, 1920, 1080, OF_WINDOW);
+	}
+	else {
+		ofSetupOpenGL(1920, 1080, OF_WINDOW);			// <-------- setup the GL context
+	}
+
+	ofApp * app = new ofApp();
+	std::unique_ptr<frameSource> source = createFrameSource(sourceName);
+	source->setRealtime(!fast && headlessFrames == 0);
+	app->setFrameSource(std::move(source));
+	if (headlessFrames > 0) {
+		app->setHeadless(headlessFrames);
+	}
+	if (!csvPath.empty()) {
+		app->setTimingLog(csvPath);
+	}
 
 	// this kicks off the running of my app
 	// can be OF_WINDOW or OF_FULLSCREEN
 	// pass in width and height too:
-	ofRunApp(new ofApp());
+	ofRunApp(app);
 
 }
@@ -0,0 +1,267 @@
+#include "motionAnalyzer.h"
+#include "imageKernels.h"
+#include <cstring>
+
+//--------------------------------------------------------------
+motionAnalyzer::~motionAnalyzer()
+{
+	stop();
+}
+
+//--------------------------------------------------------------
+bool motionAnalyzer::setup(std::unique_ptr<frameSource> _source, int width, int height, int _scale, int _threshold)
+{
+	source = std::move(_source);
+	scale = _scale;
+	threshold = _threshold;
+	if (!source || !source->setup(width, height)) {
+		source.reset();
+		return false;
+	}
+	camWidth = source->getWidth();
+	camHeight = source->getHeight();
+	return true;
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::start()
+{
+	if (source) {
+		startThread();
+	}
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::stop()
+{
+	if (isThreadRunning()) {
+		waitForThread(true);
+	}
+}
+
+//--------------------------------------------------------------
+bool motionAnalyzer::step()
+{
+	if (!source || !readFrame()) {
+		return false;
+	}
+	analyze(source->getPixels());
+	return true;
+}
+
+//--------------------------------------------------------------
+bool motionAnalyzer::update()
+{
+	return results.update();
+}
+
+//--------------------------------------------------------------
+const motionAnalysis& motionAnalyzer::getAnalysis() const
+{
+	return results.getFrontBuffer();
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::setThreshold(int _threshold)
+{
+	threshold = _threshold;
+}
+
+//--------------------------------------------------------------
+int motionAnalyzer::getThreshold() const
+{
+	return threshold;
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::setScale(int _scale)
+{
+	scale = _scale;
+}
+
+//--------------------------------------------------------------
+int motionAnalyzer::getScale() const
+{
+	return scale;
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::learnBackground()
+{
+	learn = true;
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::setPublishGray(bool publish)
+{
+	publishGray = publish;
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::setSamplePoints(const vector<ofPoint>& points)
+{
+	std::lock_guard<std::mutex> guard(sampleMutex);
+	newSamplePoints = points;
+	samplePointsChanged = true;
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::threadedFunction()
+{
+	while (isThreadRunning()) {
+		if (readFrame()) {
+			analyze(source->getPixels());
+		}
+		else {
+			sleep(1);
+		}
+	}
+}
+
+//--------------------------------------------------------------
+bool motionAnalyzer::readFrame()
+{
+	uint64_t start = ofGetElapsedTimeMicros();
+	if (!source->update()) {
+		return false;
+	}
+	captureTime = (ofGetElapsedTimeMicros() - start) / 1000.0f;
+	return true;
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::allocate(int _scale)
+{
+	// The motion detection runs on images shrunk by this factor from the
+	// camera frame
+	cvScale = _scale;
+	cvWidth = camWidth / cvScale;
+	cvHeight = camHeight / cvScale;
+	// The images are only read on this thread and never drawn, so they
+	// must not create textures, which needs the GL context
+	cvBackground.setUseTexture(false);
+	cvGrayImage.setUseTexture(false);
+	cvMotionDiff.setUseTexture(false);
+	cvGrayDiff.setUseTexture(false);
+	cvBackground.allocate(cvWidth, cvHeight);
+	cvGrayImage.allocate(cvWidth, cvHeight);
+	cvMotionDiff.allocate(cvWidth, cvHeight);
+	cvGrayDiff.allocate(cvWidth, cvHeight);
+	cvBackground.set(0);
+	cvGrayImage.set(0);
+	cvMotionDiff.set(0);
+	cvGrayDiff.set(0);
+	learn = true;
+}
+
+//--------------------------------------------------------------
+// Copies an image into a vector without the padding at the row ends
+static void copyRows(ofxCvGrayscaleImage& image, vector<unsigned char>& pixels)
+{
+	IplImage * ipl = image.getCvImage();
+	pixels.resize(image.width * image.height);
+	for (int y = 0; y < image.height; ++y) {
+		memcpy(&pixels[y * image.width], ipl->imageData + y * ipl->widthStep, image.width);
+	}
+}
+
+//--------------------------------------------------------------
+void motionAnalyzer::analyze(const unsigned char * pixels)
+{
+	// A new size starts without a previous frame or a background
+	bool reallocated = scale != cvScale;
+	if (reallocated) {
+		allocate(scale);
+	}
+
+	// One pass mirrors the frame, converts it to grey at the processing
+	// size in place of the previous frame, and thresholds its differences
+	// from the previous frame and from the background
+	uint64_t masksStart = ofGetElapsedTimeMicros();
+	int motionPixelCount, presencePixelCount;
+	IplImage * gray = cvGrayImage.getCvImage();
+	updateMotionMasks(pixels, camWidth, camHeight, cvScale, (unsigned char *)gray->imageData,
+		(unsigned char *)cvBackground.getCvImage()->imageData,
+		(unsigned char *)cvMotionDiff.getCvImage()->imageData,
+		(unsigned char *)cvGrayDiff.getCvImage()->imageData,
+		gray->widthStep, threshold, motionPixelCount, presencePixelCount);
+	cvGrayImage.flagImageChanged();
+	cvMotionDiff.flagImageChanged();
+	cvGrayDiff.flagImageChanged();
+
+	// The background is learned from the new frame. The masks were taken
+	// against the old background, and after an allocation against empty
+	// images, which would make everything brighter than the threshold
+	// count, so they are cleared for this frame.
+	if (learn.exchange(false)) {
+		cvBackground = cvGrayImage;
+		cvGrayDiff.set(0);
+		presencePixelCount = 0;
+	}
+	if (reallocated) {
+		cvMotionDiff.set(0);
+		motionPixelCount = 0;
+	}
+
+	motionAnalysis& analysis = results.getBackBuffer();
+	analysis.frame = ++frameCount;
+	analysis.width = cvWidth;
+	analysis.height = cvHeight;
+	analysis.scale = cvScale;
+	analysis.captureTime = captureTime;
+	uint64_t contoursStart = ofGetElapsedTimeMicros();
+	analysis.masksTime = (contoursStart - masksStart) / 1000.0f;
+
+	// The blob areas are limited and added up in camera pixels, whatever
+	// the processing size. An empty mask has no blobs, so its contour
+	// search is skipped.
+	int pixelArea = cvScale * cvScale;
+	int minBlobArea = max(1, 20 / pixelArea);
+	int maxBlobArea = (cvWidth * cvHeight) / 3;
+	analysis.motionArea = 0;
+	if (motionPixelCount > 0) {
+		contourFinder.findContours(cvMotionDiff, minBlobArea, maxBlobArea, 10, false);
+		for (auto& blob : contourFinder.blobs) {
+			analysis.motionArea += blob.area * pixelArea;
+		}
+	}
+	if (presencePixelCount > 0) {
+		contourFinder.findContours(cvGrayDiff, minBlobArea, maxBlobArea, 10, false);
+		analysis.blobs = contourFinder.blobs;
+	}
+	else {
+		analysis.blobs.clear();
+	}
+	analysis.contoursTime = (ofGetElapsedTimeMicros() - contoursStart) / 1000.0f;
+	copyRows(cvGrayDiff, analysis.presence);
+	if (publishGray) {
+		copyRows(cvGrayImage, analysis.gray);
+	}
+	else {
+		analysis.gray.clear();
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(sampleMutex);
+		if (samplePointsChanged) {
+			samplePoints.swap(newSamplePoints);
+			samplePointsChanged = false;
+		}
+	}
+	analysis.sampleStates.resize(samplePoints.size());
+	for (int i = 0; i < samplePoints.size(); ++i) {
+		int x = samplePoints[i].x * cvWidth;
+		int y = samplePoints[i].y * cvHeight;
+		if (x < 0 || x >= cvWidth || y < 0 || y >= cvHeight) {
+			analysis.sampleStates[i] = motionAnalysis::SAMPLE_OUTSIDE;
+		}
+		else if (analysis.presence[y * cvWidth + x] > 0) {
+			analysis.sampleStates[i] = motionAnalysis::SAMPLE_PRESENT;
+		}
+		else {
+			analysis.sampleStates[i] = motionAnalysis::SAMPLE_CLEAR;
+		}
+	}
+
+	results.publish();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOpenCv.h"
+#include "frameSource.h"
+#include "tripleBuffer.h"
+
+#include <atomic>
+#include <mutex>
+
+// The result of analysing one frame. Positions and sizes are in
+// processing pixels, apart from motionArea.
+struct motionAnalysis {
+	// What the presence mask holds at a sample point
+	enum sampleState : unsigned char {
+		SAMPLE_OUTSIDE,
+		SAMPLE_CLEAR,
+		SAMPLE_PRESENT
+	};
+
+	// Number of the analysed frame, counting from 1
+	uint64_t frame = 0;
+	int width = 0;
+	int height = 0;
+	int scale = 2;
+	// Mask of the pixels that differ from the background, 255 or 0
+	vector<unsigned char> presence;
+	// Outlines of the regions of the presence mask
+	vector<ofxCvBlob> blobs;
+	// Total area of the regions that moved since the previous frame, in
+	// camera pixels
+	float motionArea = 0;
+	// The state of the presence mask at each of the sample points,
+	// SAMPLE_OUTSIDE where the point is outside the processed frame
+	vector<sampleState> sampleStates;
+	// The grey frame at the processing size, only filled in while
+	// setPublishGray(true)
+	vector<unsigned char> gray;
+	// How long reading the frame, the mask pass and the contour searches
+	// took, in milliseconds
+	float captureTime = 0;
+	float masksTime = 0;
+	float contoursTime = 0;
+};
+
+// Reads frames from a frameSource and runs the motion detection on them on
+// its own thread. The render thread picks up the latest result with update(),
+// which never waits, so the frame rate does not depend on the camera or on
+// the cost of the contour search. The settings can be changed from the
+// render thread at any time and apply from the next frame.
+class motionAnalyzer : public ofThread {
+public:
+	~motionAnalyzer();
+
+	// Takes over the source and opens it at the given frame size, returning
+	// whether that worked
+	bool setup(std::unique_ptr<frameSource> source, int width, int height, int scale, int threshold);
+	void start();
+	void stop();
+	// Reads and analyses one frame on the calling thread, for runs that
+	// must not skip frames, instead of start(). Returns whether there was
+	// a new frame.
+	bool step();
+
+	// Takes the most recent result, returning whether there was a new one
+	bool update();
+	const motionAnalysis& getAnalysis() const;
+
+	void setThreshold(int threshold);
+	int getThreshold() const;
+	void setScale(int scale);
+	int getScale() const;
+	void learnBackground();
+	void setPublishGray(bool publish);
+
+	// Points to report the presence mask at, as fractions of the frame
+	// size. Results keep the points they were made with until the next
+	// frame after the call.
+	void setSamplePoints(const vector<ofPoint>& points);
+
+private:
+	void threadedFunction();
+	void allocate(int scale);
+	bool readFrame();
+	void analyze(const unsigned char * pixels);
+
+	std::unique_ptr<frameSource> source;
+	int camWidth = 0;
+	int camHeight = 0;
+
+	// Worker state
+	int cvScale = 0;
+	int cvWidth = 0;
+	int cvHeight = 0;
+	ofxCvGrayscaleImage cvBackground;
+	ofxCvGrayscaleImage cvGrayImage;
+	ofxCvGrayscaleImage cvMotionDiff;
+	ofxCvGrayscaleImage cvGrayDiff;
+	ofxCvContourFinder contourFinder;
+	vector<ofPoint> samplePoints;
+	uint64_t frameCount = 0;
+	float captureTime = 0;
+
+	// Settings from the render thread
+	std::atomic<int> threshold{50};
+	std::atomic<int> scale{2};
+	std::atomic<bool> learn{true};
+	std::atomic<bool> publishGray{false};
+	std::mutex sampleMutex;
+	vector<ofPoint> newSamplePoints;
+	bool samplePointsChanged = false;
+
+	tripleBuffer<motionAnalysis> results;
+};
@@ -6,6 +6,25 @@ void ofApp::setup()
 {
     ofSetWindowTitle("VoronoiCam");
     ofBackground(BACKGROUND_COLOR);
+	// The shape vertices and colours change all the time, the triangles
+	// only with the cells
+	shapesMesh.setUsage(GL_DYNAMIC_DRAW);
+
+	stageFrame = profiler.addStage("frame");
+	stageUpdate = profiler.addStage("update");
+	stageCapture = profiler.addStage("capture");
+	stageMasks = profiler.addStage("masks");
+	stageContours = profiler.addStage("contours");
+	stageFloatPoints = profiler.addStage("floatPoints");
+	stageShapes = profiler.addStage("shapes");
+	stageVisibility = profiler.addStage("visibility");
+	stageDrawVoronoi = profiler.addStage("drawVoronoi");
+	stageDrawShapes = profiler.addStage("drawShapes");
+	stageDrawCam = profiler.addStage("drawCam");
+	stageDrawCamImage = profiler.addStage("drawCamImage");
+	if (!timingLogPath.empty()) {
+		profiler.openCsv(timingLogPath);
+	}
 
 	blobActionAreaSum = 0;
 	blobActionTimer = 0;
@@ -13,30 +32,53 @@ void ofApp::setup()
 	drawCam = false;
 	drawVoronoi = false;
 	drawCamImage = false;
-	learnBackground = true;
-
-	camWidth = 1280;
-	camHeight = 720;
-	cam.setup(1280, 720);
-	camMirror = new unsigned char[camWidth*camHeight * 3];
-	//mirrorTexture.allocate(camWidth, camHeight, GL_RGB);
-	cvImage.allocate(camWidth, camHeight);
-	cvBackground.allocate(camWidth, camHeight);
-	oldCvGrayImage.allocate(camWidth, camHeight);
-	cvGrayImage.allocate(camWidth, camHeight);
-	cvGrayDiff.allocate(camWidth, camHeight);
-	cvThreshold = 50;
+	regenerateVoronoi = false;
+
+	// The frames are read and analysed on the analyzer's thread, at half
+	// size so that the contour searches visit a quarter of the pixels
+	if (!source) {
+		source = createFrameSource("camera");
+	}
+	if (!analyzer.setup(std::move(source), 1280, 720, 2, 50)) {
+		ofLogError("ofApp") << "can't open the frame source";
+	}
+	if (headlessFrames > 0) {
+		profiler.setKeepFrames(true);
+		ofSetFrameRate(0);
+	}
+	else {
+		analyzer.start();
+	}
 	float camScreenRatio = 0.3;
-	camImageRect.set(ofGetWidth() * camScreenRatio, ofGetHeight() - ofGetHeight() * camScreenRatio, ofGetWidth() * camScreenRatio * -1, ofGetHeight() * camScreenRatio);
+	camImageRect.set(0, ofGetHeight() - ofGetHeight() * camScreenRatio, ofGetWidth() * camScreenRatio, ofGetHeight() * camScreenRatio);
 
     ofRectangle bounds = ofRectangle(-50, -50, ofGetWidth() + 100, ofGetHeight() + 100);
     int pointCount = 255;
 	int relaxationSteps = 10;
-	int seed = ofRandom(ofGetUnixTime());
+	// Profiling runs use the same cells every time
+	int seed = headlessFrames > 0 ? 1 : ofRandom(ofGetUnixTime());
     
 	setupVoronoi(pointCount, seed, relaxationSteps, bounds, false);
 }
 
+//--------------------------------------------------------------
+void ofApp::setFrameSource(std::unique_ptr<frameSource> _source)
+{
+	source = std::move(_source);
+}
+
+//--------------------------------------------------------------
+void ofApp::setHeadless(int frames)
+{
+	headlessFrames = frames;
+}
+
+//--------------------------------------------------------------
+void ofApp::setTimingLog(const string& csvPath)
+{
+	timingLogPath = csvPath;
+}
+
 //--------------------------------------------------------------
 void ofApp::setupVoronoi(int pointCount, int seed, int relaxationSteps, ofRectangle bounds, bool beehive)
 {
@@ -91,91 +133,112 @@ void ofApp::setupVoronoi(int pointCount, int seed, int relaxationSteps, ofRectan
 //--------------------------------------------------------------
 void ofApp::update()
 {
+	profiler.beginFrame();
+	profiler.add(stageFrame, ofGetLastFrameTime() * 1000);
+	profiler.begin(stageUpdate);
 	blobActionTimer -= ofGetLastFrameTime();
 	if (blobActionTimer <= 0) {
 		blobActionTimer = MIN_BLOB_ACTION_TIME;
 		blobActionAreaSum = 0;
-		learnBackground = true;
+		analyzer.learnBackground();
 	}
-	updateCvBackground();
-	mirrorCam();
-	updateContourBlobs();
-	floatPoints(false);
+	if (headlessFrames > 0) {
+		analyzer.step();
+	}
+	if (analyzer.update()) {
+		// The analysis is timed where it runs, which is usually the
+		// analyzer's thread
+		const motionAnalysis& analysis = analyzer.getAnalysis();
+		profiler.add(stageCapture, analysis.captureTime);
+		profiler.add(stageMasks, analysis.masksTime);
+		profiler.add(stageContours, analysis.contoursTime);
+		updateBlobAction();
+	}
+	floatPoints(regenerateVoronoi);
+	profiler.begin(stageVisibility);
 	updateAnimShapeVisibility();
+	profiler.end(stageVisibility);
+	profiler.end(stageUpdate);
 }
 
 //--------------------------------------------------------------
-void ofApp::updateCvBackground()
+void ofApp::finishHeadlessRun()
 {
-	if (learnBackground) {
-		cvBackground = oldCvGrayImage;
-		learnBackground = false;
-	}
-	oldCvGrayImage = cvGrayImage;
+	profiler.writeSummary(cout);
+	profiler.closeCsv();
+	headlessFrames = 0;
+	ofExit();
 }
 
 //--------------------------------------------------------------
-void ofApp::mirrorCam()
+void ofApp::updateBlobAction()
 {
-	cam.update();
-	if (cam.isFrameNew()) {
-		unsigned char * pixels = cam.getPixels();
-		for (int i = 0; i < camHeight; i++) {
-			for (int j = 0; j < camWidth * 3; j += 3) {
-				// pixel number
-				int pix1 = (i*camWidth * 3) + j;
-				int pix2 = (i*camWidth * 3) + (j + 1);
-				int pix3 = (i*camWidth * 3) + (j + 2);
-				// mirror pixel number
-				int mir1 = (i*camWidth * 3) + 1 * (camWidth * 3 - j - 3);
-				int mir2 = (i*camWidth * 3) + 1 * (camWidth * 3 - j - 2);
-				int mir3 = (i*camWidth * 3) + 1 * (camWidth * 3 - j - 1);
-				// swap pixels
-				camMirror[pix1] = pixels[mir1];
-				camMirror[pix2] = pixels[mir2];
-				camMirror[pix3] = pixels[mir3];
-			}
-		}
-		cvImage.setFromPixels(camMirror, camWidth, camHeight);
+	const motionAnalysis& analysis = analyzer.getAnalysis();
+	blobActionAreaSum += analysis.motionArea;
+	if (blobActionAreaSum >= MAX_BLOB_AREA_ACTION * MIN_BLOB_ACTION_TIME) {
+		blobActionTimer = MIN_BLOB_ACTION_TIME;
+		blobActionAreaSum = 0;
+	}
+	if (drawCam) {
+		showPixels(presenceView, analysis.presence, analysis.width, analysis.height);
+	}
+	if (drawCamImage && !analysis.gray.empty()) {
+		showPixels(grayView, analysis.gray, analysis.width, analysis.height);
 	}
 }
 
-void ofApp::updateContourBlobs()
+//--------------------------------------------------------------
+void ofApp::showPixels(ofxCvGrayscaleImage& image, const vector<unsigned char>& pixels, int width, int height)
 {
-	cvGrayImage = cvImage;
-	cvGrayDiff.absDiff(oldCvGrayImage, cvGrayImage);
-	cvGrayDiff.threshold(cvThreshold);
-	contourFinder.findContours(cvGrayDiff, 20, (camWidth * camHeight) / 3, 10, false);
-	for (auto blob : contourFinder.blobs) {
-		blobActionAreaSum += blob.area;
+	if (image.width != width || image.height != height) {
+		image.allocate(width, height);
 	}
-	if (blobActionAreaSum >= MAX_BLOB_AREA_ACTION * MIN_BLOB_ACTION_TIME) {
-		blobActionTimer = MIN_BLOB_ACTION_TIME;
-		blobActionAreaSum = 0;
-	}
-	cvGrayDiff.absDiff(cvBackground, cvGrayImage);
-	cvGrayDiff.threshold(cvThreshold);
-	contourFinder.findContours(cvGrayDiff, 20, (camWidth * camHeight) / 3, 10, false);
+	image.setFromPixels(pixels.data(), width, height);
 }
 
+//--------------------------------------------------------------
 void ofApp::updateAnimShapeVisibility() {
+	// The analyzer samples the presence mask at the shape centres. Its
+	// results are for the centres of an earlier frame, so until it has
+	// caught up with a change in the shape count the mask is sampled here.
+	const motionAnalysis& analysis = analyzer.getAnalysis();
+	vector<ofPoint> samplePoints;
 	for (auto& animShape : shapes) {
+		samplePoints.push_back(ofPoint(animShape.center.x / ofGetWidth(), animShape.center.y / ofGetHeight()));
+	}
+	analyzer.setSamplePoints(samplePoints);
+	bool sampled = analysis.sampleStates.size() == shapes.size();
+	if (!sampled && analysis.presence.empty()) {
+		return;
+	}
+
+	for (int i = 0; i < shapes.size(); ++i) {
+		animShape& animShape = shapes[i];
 		bool visible = true;
-		int animShapePositionX = (animShape.center.x / ofGetWidth()) * camWidth;
-		int animShapePositionY = (animShape.center.y / ofGetHeight()) * camHeight;
-		if (!ofRectangle(0, 0, cvGrayDiff.width, cvGrayDiff.height).inside(animShapePositionX, animShapePositionY)) {
-			continue;
+		if (sampled) {
+			// Shapes outside the processed frame keep their visibility
+			if (analysis.sampleStates[i] == motionAnalysis::SAMPLE_OUTSIDE) {
+				continue;
+			}
+			visible = analysis.sampleStates[i] == motionAnalysis::SAMPLE_CLEAR;
 		}
-		int pixelBrightness = cvGrayDiff.getPixels()[animShapePositionY * cvGrayDiff.width + animShapePositionX];
-		if (pixelBrightness > 0) {
-			visible = false;
+		else {
+			int animShapePositionX = samplePoints[i].x * analysis.width;
+			int animShapePositionY = samplePoints[i].y * analysis.height;
+			if (!ofRectangle(0, 0, analysis.width, analysis.height).inside(animShapePositionX, animShapePositionY)) {
+				continue;
+			}
+			int pixelBrightness = analysis.presence[animShapePositionY * analysis.width + animShapePositionX];
+			if (pixelBrightness > 0) {
+				visible = false;
+			}
 		}
 		animShape.visible = visible;
 		if (visible) {
-			animShape.shape.setColor(SHAPE_COLOR_NORMAL);
+			setShapeColor(animShape, SHAPE_COLOR_NORMAL);
 		}
 		else {
-			animShape.shape.setColor(SHAPE_COLOR_ACTIVE);
+			setShapeColor(animShape, SHAPE_COLOR_ACTIVE);
 		}
 	}
 }
@@ -183,13 +246,14 @@ void ofApp::updateAnimShapeVisibility() {
 //--------------------------------------------------------------
 bool ofApp::pointInPolygon(int pno, int x, int y)
 {
-	int i, j = contourFinder.blobs[pno].pts.size() - 1;
+	const vector<ofxCvBlob>& blobs = analyzer.getAnalysis().blobs;
+	int i, j = blobs[pno].pts.size() - 1;
 	bool  oddNodes = false;
 
-	for (i = 0; i<contourFinder.blobs[pno].pts.size(); i++) {
-		if (contourFinder.blobs[pno].pts[i].y<y && contourFinder.blobs[pno].pts[j].y >= y
-			|| contourFinder.blobs[pno].pts[j].y<y && contourFinder.blobs[pno].pts[i].y >= y) {
-			if (contourFinder.blobs[pno].pts[i].x + (y - contourFinder.blobs[pno].pts[i].y) / (contourFinder.blobs[pno].pts[j].y - contourFinder.blobs[pno].pts[i].y)*(contourFinder.blobs[pno].pts[j].x - contourFinder.blobs[pno].pts[i].x)<x) {
+	for (i = 0; i<blobs[pno].pts.size(); i++) {
+		if (blobs[pno].pts[i].y<y && blobs[pno].pts[j].y >= y
+			|| blobs[pno].pts[j].y<y && blobs[pno].pts[i].y >= y) {
+			if (blobs[pno].pts[i].x + (y - blobs[pno].pts[i].y) / (blobs[pno].pts[j].y - blobs[pno].pts[i].y)*(blobs[pno].pts[j].x - blobs[pno].pts[i].x)<x) {
 				oddNodes = !oddNodes;
 			}
 		}
@@ -202,31 +266,125 @@ bool ofApp::pointInPolygon(int pno, int x, int y)
 //--------------------------------------------------------------
 void ofApp::floatPoints(bool regenVoronoi)
 {
+	// The shapes are timed apart, in generateShapes()
+	profiler.begin(stageFloatPoints);
 	if (regenVoronoi) {
-		vector <ofPoint> newPoints;
-		for (auto point : points) {
-			newPoints.push_back(ofPoint(point));
-			newPoints.at(newPoints.size() - 1).x = point.x + sin(point.y + ofGetFrameNum() * 0.1f) * 3;
-			newPoints.at(newPoints.size() - 1).y = point.y + cos(point.x + ofGetFrameNum() * 0.1f) * 3;
+		// Only the points under the blobs move, and the points that the
+		// blobs have left go back to where they started. generate() only
+		// recomputes the cells around the points that moved.
+		ofRectangle region = getBlobRegion();
+		vector <ofPoint>& newPoints = voronoi.getPoints();
+		bool moved = false;
+		for (int i = 0; i < points.size() && i < newPoints.size(); ++i) {
+			auto point = points.at(i);
+			if (!region.isEmpty() && region.inside(point)) {
+				newPoints.at(i).x = point.x + sin(point.y + ofGetFrameNum() * 0.1f) * 3;
+				newPoints.at(i).y = point.y + cos(point.x + ofGetFrameNum() * 0.1f) * 3;
+				moved = true;
+			}
+			else if (newPoints.at(i) != point) {
+				newPoints.at(i) = point;
+				moved = true;
+			}
+		}
+		if (!moved) {
+			profiler.end(stageFloatPoints);
+			return;
 		}
-		voronoi.clear();
-		voronoi.setPoints(newPoints);
 		voronoi.generate();
+		profiler.end(stageFloatPoints);
 		shapes = generateShapes(voronoi.getCells());
 	}
 	else {
-		vector <ofxVoronoiCell> newCells;
-		for (auto cell : cells) {
-			newCells.push_back(cell);
-			newCells.at(newCells.size() - 1).pt = getNewFloatyPointPosition(cell.pt, 0.01f, 7);
-			for (int i = 0; i < cell.pts.size(); ++i) {
-				newCells.at(newCells.size() - 1).pts.at(i) = getNewFloatyPointPosition(cell.pts.at(i), 0.04f, 7);
-			}
+		// The shapes keep their outlines and only move their vertices
+		for (auto& shape : shapes) {
+			floatShape(shape);
 		}
-		shapes = generateShapes(newCells);
+		profiler.end(stageFloatPoints);
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::floatShape(animShape& shape)
+{
+	// The corners and the centre float as the cells' points used to, and
+	// the outline is evaluated from them straight into the shapes' mesh
+	floatingCorners.resize(shape.cornerPoints.size());
+	for (int i = 0; i < shape.cornerPoints.size(); ++i) {
+		floatingCorners[i] = getNewFloatyPointPosition(shape.cornerPoints[i], 0.04f, 7);
+	}
+	shape.center = getNewFloatyPointPosition(shape.restCenter, 0.01f, 7);
+	if (shape.vertexCount > 0) {
+		setOutlineVertices(shape.firstVertex, floatingCorners, shape.center);
 	}
 }
 
+//--------------------------------------------------------------
+void ofApp::setShapeColor(animShape& shape, const ofColor& color)
+{
+	// Only the colours that change are written, so the colour buffer is
+	// only uploaded again when a shape changes its state
+	if (shape.color == color) {
+		return;
+	}
+	shape.color = color;
+	for (int i = 0; i < shape.vertexCount; ++i) {
+		shapesMesh.setColor(shape.firstVertex + i, color);
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::setOutlineVertices(int firstVertex, const vector<ofPoint>& corners, ofPoint center)
+{
+	// A smoothed bezier segment from each corner to the next, shrunk
+	// around the centre
+	shapesMesh.setVertex(firstVertex, center);
+	int vertex = firstVertex + 1;
+	for (int i = 0; i < corners.size(); ++i) {
+		auto previous = corners.at((i - 1) < 0 ? corners.size() - 1 : i - 1);
+		auto point = corners.at(i);
+		auto next = corners.at((i + 1) == corners.size() ? 0 : i + 1);
+		auto nextNext = corners.at((i + 2) == corners.size() ? 0 : (i + 1) == corners.size() ? 1 : i + 2);
+		
+		float smoothing = 0.3f;
+
+		auto tangentA = (previous - next).getNormalized();
+		auto handleA = point - tangentA * point.distance(next) * smoothing;
+
+		auto tangentB = (point - nextNext).getNormalized();
+		auto handleB = next + tangentB * point.distance(next) * smoothing;
+		
+		for (int step = 0; step < SHAPE_CURVE_RESOLUTION; ++step) {
+			float t = step / (float)SHAPE_CURVE_RESOLUTION;
+			float u = 1 - t;
+			ofPoint curvePoint = point * (u * u * u) + handleA * (3 * u * u * t) + handleB * (3 * u * t * t) + next * (t * t * t);
+			shapesMesh.setVertex(vertex++, curvePoint * SHAPE_SCALE + center * (1 - SHAPE_SCALE));
+		}
+	}
+}
+
+//--------------------------------------------------------------
+ofRectangle ofApp::getBlobRegion()
+{
+	// Union of the blob bounding boxes, scaled from processing to screen
+	// space
+	const motionAnalysis& analysis = analyzer.getAnalysis();
+	ofRectangle region;
+	float scaleX = (float)ofGetWidth() / analysis.width;
+	float scaleY = (float)ofGetHeight() / analysis.height;
+	for (int i = 0; i < analysis.blobs.size(); ++i) {
+		ofRectangle rect = analysis.blobs[i].boundingRect;
+		rect.set(rect.x * scaleX, rect.y * scaleY, rect.width * scaleX, rect.height * scaleY);
+		if (i == 0) {
+			region = rect;
+		}
+		else {
+			region.growToInclude(rect);
+		}
+	}
+	return region;
+}
+
 //--------------------------------------------------------------
 ofPoint ofApp::getNewFloatyPointPosition(ofPoint basePosition, float speed, float distance)
 {
@@ -240,31 +398,61 @@ ofPoint ofApp::getNewFloatyPointPosition(ofPoint basePosition, float speed, floa
 void ofApp::draw()
 {
 	if (drawVoronoi) {
+		stageProfiler::scopedTimer timer(profiler, stageDrawVoronoi);
 		voronoi.draw();
 	}
-	for(auto& shape : shapes) {
-		//if (shape.visible) {
-			shape.shape.draw();
-		//}
+	// Drawing the mesh uploads it to a VBO, which needs the GL context that
+	// a headless run does not have. The shapes are still updated.
+	if (headlessFrames == 0) {
+		stageProfiler::scopedTimer timer(profiler, stageDrawShapes);
+		shapesMesh.draw();
 	}
 	if (drawCam) {
-		cvImage.draw(0, 0, ofGetWidth(), ofGetHeight());
-		cvGrayDiff.draw(0, 0, ofGetWidth(), ofGetHeight());
-		contourFinder.draw(0, 0, ofGetWidth(), ofGetHeight());
-		//for (int i = 0; i < contourFinder.blobs.size(); ++i) {
-		//	contourFinder.blobs.at(i).draw();
-		//	//ofDrawRectangle(contourFinder.blobs.at(i).boundingRect);
-		//}
+		stageProfiler::scopedTimer timer(profiler, stageDrawCam);
+		const motionAnalysis& analysis = analyzer.getAnalysis();
+		if (presenceView.width > 0) {
+			presenceView.draw(0, 0, ofGetWidth(), ofGetHeight());
+		}
+		if (analysis.width > 0) {
+			ofPushStyle();
+			ofPushMatrix();
+			ofScale((float)ofGetWidth() / analysis.width, (float)ofGetHeight() / analysis.height);
+			ofSetColor(0, 255, 255);
+			for (auto& blob : analysis.blobs) {
+				ofPolyline outline(blob.pts);
+				outline.close();
+				outline.draw();
+			}
+			ofPopMatrix();
+			ofPopStyle();
+		}
 		stringstream str;
-		str << "Threshold: " << cvThreshold;
+		str << "Threshold: " << analyzer.getThreshold() << endl;
+		str << "Processing: " << analysis.width << "x" << analysis.height << endl;
+		str << "Timing log: " << (profiler.isCsvOpen() ? "on" : "off");
 		ofDrawBitmapString(str.str(), 100, 100);
+		profiler.draw(100, 160);
 	}
-	if (drawCamImage)
+	if (drawCamImage && grayView.width > 0)
 	{
-		cam.draw(camImageRect);
+		stageProfiler::scopedTimer timer(profiler, stageDrawCamImage);
+		// The grey frame is already mirrored
+		grayView.draw(camImageRect);
+	}
+
+	// The frame ends here, so its times include the drawing
+	profiler.endFrame(ofGetFrameNum());
+	if (headlessFrames > 0 && profiler.getFrameCount() >= headlessFrames) {
+		finishHeadlessRun();
 	}
 }
 
+//--------------------------------------------------------------
+void ofApp::exit()
+{
+	analyzer.stop();
+}
+
 //--------------------------------------------------------------
 vector <ofPoint> ofApp::generateRandomPoints(int count, int seed, ofRectangle bounds)
 {
@@ -311,11 +499,15 @@ vector <ofPoint> ofApp::generateBeehivePoints(ofPoint size, ofPoint variance, in
 //--------------------------------------------------------------
 vector <ofApp::animShape> ofApp::generateShapes(vector<ofxVoronoiCell> cells)
 {
+	profiler.begin(stageShapes);
 	this->shapes.clear();
 	vector <animShape> shapes;
+	shapesMesh.clear();
+	shapesMesh.setMode(OF_PRIMITIVE_TRIANGLES);
 	for (auto cell : cells) {
 		shapes.push_back(generateShape(cell.pts, cell.pt));
 	}
+	profiler.end(stageShapes);
 	return shapes;
 }
 
@@ -347,32 +539,26 @@ ofApp::animShape ofApp::generateShape(vector <ofPoint> points, ofPoint center, b
 		reducedPoints = points;
 	}
 
-	for (int i = 0; i < reducedPoints.size(); ++i) {
-		auto previous = reducedPoints.at((i - 1) < 0 ? reducedPoints.size() - 1 : i - 1);
-		auto point = reducedPoints.at(i);
-		auto next = reducedPoints.at((i + 1) == reducedPoints.size() ? 0 : i + 1);
-		auto nextNext = reducedPoints.at((i + 2) == reducedPoints.size() ? 0 : (i + 1) == reducedPoints.size() ? 1 : i + 2);
-		
-		float smoothing = 0.3f;
-
-		auto tangentA = (previous - next).getNormalized();
-		auto handleA = point - tangentA * point.distance(next) * smoothing;
-
-		auto tangentB = (point - nextNext).getNormalized();
-		auto handleB = next + tangentB * point.distance(next) * smoothing;
-		
-		if (i == 0) {
-			shape.shape.moveTo(point);
-		}
-		shape.shape.bezierTo(handleA, handleB, next);
+	// The outline is flattened and added to the shapes' mesh with a fixed
+	// layout, so while the shape floats only its vertices are moved, and
+	// it is never built up or tessellated again
+	int outlineVertices = reducedPoints.size() * SHAPE_CURVE_RESOLUTION;
+	shape.firstVertex = shapesMesh.getNumVertices();
+	shape.vertexCount = outlineVertices + 1;
+	for (int i = 0; i < shape.vertexCount; ++i) {
+		shapesMesh.addVertex(center);
+		shapesMesh.addColor(SHAPE_COLOR_NORMAL);
+	}
+	setOutlineVertices(shape.firstVertex, reducedPoints, center);
+	for (int i = 0; i < outlineVertices; ++i) {
+		shapesMesh.addIndex(shape.firstVertex);
+		shapesMesh.addIndex(shape.firstVertex + i + 1);
+		shapesMesh.addIndex(shape.firstVertex + (i + 1) % outlineVertices + 1);
 	}
-	float scaleFactor = 0.75f;
-	shape.shape.scale(scaleFactor, scaleFactor);
-	shape.shape.translate(center - center * scaleFactor);
-
-	shape.shape.setFillColor(SHAPE_COLOR_NORMAL);
 
+	shape.color = SHAPE_COLOR_NORMAL;
 	shape.cornerPoints = reducedPoints;
+	shape.restCenter = center;
 	shape.center = center;
 	shape.visible = true;
 	return shape;
@@ -389,16 +575,38 @@ void ofApp::keyPressed(int key)
 	case 'i':
 	case 'I':
 		drawCamImage = !drawCamImage;
+		analyzer.setPublishGray(drawCamImage);
 		break;
 	case 'v':
 	case 'V':
 		drawVoronoi = !drawVoronoi;
 		break;
+	case 'r':
+	case 'R':
+		regenerateVoronoi = !regenerateVoronoi;
+		// Floating starts again from the cells at rest
+		if (!regenerateVoronoi) {
+			shapes = generateShapes(cells);
+		}
+		break;
+	case 'p':
+	case 'P':
+		analyzer.setScale(analyzer.getScale() >= 4 ? 1 : analyzer.getScale() * 2);
+		break;
 	case '+':
-		++cvThreshold;
+		analyzer.setThreshold(analyzer.getThreshold() + 1);
 		break;
 	case '-':
-		--cvThreshold;
+		analyzer.setThreshold(analyzer.getThreshold() - 1);
+		break;
+	case 'l':
+	case 'L':
+		if (profiler.isCsvOpen()) {
+			profiler.closeCsv();
+		}
+		else {
+			profiler.openCsv("timings_" + ofGetTimestampString() + ".csv");
+		}
 		break;
 	}
 }
@@ -3,13 +3,21 @@
 #include "ofMain.h"
 #include "ofxVoronoi.h"
 #include "ofxOpenCv.h"
+#include "motionAnalyzer.h"
+#include "stageProfiler.h"
 
 class ofApp : public ofBaseApp{
     private:
 		struct animShape {
 			vector<ofPoint> cornerPoints;
+			ofPoint restCenter;
 			ofPoint center;
-			ofPath shape;
+			// The shape's vertices in shapesMesh: the centre, followed by
+			// SHAPE_CURVE_RESOLUTION vertices of the flattened outline per
+			// corner
+			int firstVertex = 0;
+			int vertexCount = 0;
+			ofColor color;
 			bool visible;
 		};
 
@@ -18,47 +26,75 @@ class ofApp : public ofBaseApp{
 		vector <animShape> generateShapes(vector<ofxVoronoiCell> cells);
 		animShape generateShape(vector <ofPoint> points, ofPoint center, bool reducePoints = false);
 		ofPoint getNewFloatyPointPosition(ofPoint basePosition, float speed, float distance);
+		void floatShape(animShape& shape);
+		void setOutlineVertices(int firstVertex, const vector<ofPoint>& corners, ofPoint center);
+		void setShapeColor(animShape& shape, const ofColor& color);
 		bool pointInPolygon(int pno, int x, int y);
 		void setupVoronoi(int pointCount, int seed, int relaxationSteps, ofRectangle bounds, bool beehive);
 		void floatPoints(bool regenVoronoi);
-		void updateCvBackground();
-		void mirrorCam();
-		void updateContourBlobs();
+		void updateBlobAction();
+		void showPixels(ofxCvGrayscaleImage& image, const vector<unsigned char>& pixels, int width, int height);
 		void updateAnimShapeVisibility();
+		ofRectangle getBlobRegion();
+		void finishHeadlessRun();
 
         ofxVoronoi voronoi;
         vector<ofPoint> points;
 		vector<ofxVoronoiCell> cells;
 		vector<animShape> shapes;
-		ofVideoGrabber cam;
-		//ofTexture mirrorTexture;
-		ofxCvColorImage cvImage;
-		ofxCvGrayscaleImage cvBackground;
-		ofxCvGrayscaleImage oldCvGrayImage;
-		ofxCvGrayscaleImage cvGrayImage;
-		ofxCvGrayscaleImage cvGrayDiff;
-		ofxCvContourFinder contourFinder;
+		// The fills of all shapes as one mesh, drawn at once
+		ofVboMesh shapesMesh;
+		vector<ofPoint> floatingCorners;
+		std::unique_ptr<frameSource> source;
+		motionAnalyzer analyzer;
+		ofxCvGrayscaleImage presenceView;
+		ofxCvGrayscaleImage grayView;
 		ofRectangle camImageRect;
-		unsigned char * camMirror;
+		stageProfiler profiler;
+		int stageFrame;
+		int stageUpdate;
+		int stageCapture;
+		int stageMasks;
+		int stageContours;
+		int stageFloatPoints;
+		int stageShapes;
+		int stageVisibility;
+		int stageDrawVoronoi;
+		int stageDrawShapes;
+		int stageDrawCam;
+		int stageDrawCamImage;
+		int headlessFrames = 0;
+		string timingLogPath;
 		float blobActionTimer;
 		float blobActionAreaSum;
-		int camWidth;
-		int camHeight;
-		int cvThreshold;
 		bool drawCam;
 		bool drawVoronoi;
 		bool drawCamImage;
-		bool learnBackground;
+		bool regenerateVoronoi;
 		const ofColor BACKGROUND_COLOR = ofColor(255, 200, 50);
 		const ofColor SHAPE_COLOR_NORMAL = ofColor(20, 155, 95);
 		const ofColor SHAPE_COLOR_ACTIVE = ofColor(15, 105, 175);
 		const float MAX_BLOB_AREA_ACTION = 1000;
 		const float MIN_BLOB_ACTION_TIME = 5;
+		const float SHAPE_SCALE = 0.75f;
+		const int SHAPE_CURVE_RESOLUTION = 20;
 
 	public:
+		// Replaces the camera, before setup()
+		void setFrameSource(std::unique_ptr<frameSource> source);
+		// Makes the app a profiling run without a window, before setup().
+		// The analysis runs in step with update(), so no frames are
+		// skipped, and after the given number of frames the stage timings
+		// are written to stdout.
+		void setHeadless(int frames);
+		// Streams the stage timings of every frame to a CSV file, before
+		// setup(). The 'l' key starts and stops a log while running.
+		void setTimingLog(const string& csvPath);
+
 		void setup();
 		void update();
 		void draw();
+		void exit();
 
 		void keyPressed(int key);
 		void keyReleased(int key);
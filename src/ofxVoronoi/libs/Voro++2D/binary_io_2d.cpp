@@ -0,0 +1,277 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file binary_io_2d.cpp
+ * \brief Function implementations for the binary particle and tessellation
+ * file classes. */
+
+#include "binary_io_2d.h"
+
+#include <climits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace voro {
+
+/** Sets up a header for a file with no records.
+ * \param[in] radius whether the records will carry a radius. */
+void binary_particle_header_2d::init(bool radius) {
+	magic=binary_particle_magic;
+	version=binary_particle_version;
+	flags=radius?binary_particle_radius:0;
+	rsize=radius?28:20;
+	n=0;
+}
+
+/** Checks that a header that has been read from a file is valid. If it is
+ * not, then the routine causes a fatal error. */
+void binary_particle_header_2d::check() {
+	if(magic!=binary_particle_magic) voro_fatal_error("Binary import error - not a binary particle file",VOROPP_FILE_ERROR);
+	if(version!=binary_particle_version) voro_fatal_error("Binary import error - unsupported file version",VOROPP_FILE_ERROR);
+	if(rsize!=(has_radius()?28u:20u)||n<0) voro_fatal_error("Binary import error - corrupt header",VOROPP_FILE_ERROR);
+}
+
+/** Writes a binary particle header to an open file stream.
+ * \param[in] h the header to write.
+ * \param[in] fp the file handle to write to. */
+void write_binary_particle_header(binary_particle_header_2d &h,FILE *fp) {
+	if(fwrite(&h,sizeof(binary_particle_header_2d),1,fp)!=1)
+		voro_fatal_error("Binary export error - can't write header",VOROPP_FILE_ERROR);
+}
+
+/** Rewrites a binary particle header that was written earlier to a seekable
+ * file stream, once the total number of records is known, and then moves back
+ * to the end of the file.
+ * \param[in] h the header to write.
+ * \param[in] pos the file position at which the header was written.
+ * \param[in] fp the file handle to write to. */
+void rewrite_binary_particle_header(binary_particle_header_2d &h,long pos,FILE *fp) {
+	if(fseek(fp,pos,SEEK_SET)!=0) voro_fatal_error("Binary export error - file is not seekable",VOROPP_FILE_ERROR);
+	write_binary_particle_header(h,fp);
+	fseek(fp,0,SEEK_END);
+}
+
+/** The class constructor opens a file and maps its entire contents into
+ * memory.
+ * \param[in] filename the name of the file to map. */
+mapped_file_2d::mapped_file_2d(const char *filename) {
+#ifdef _WIN32
+	fh=CreateFileA(filename,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+	if(fh==INVALID_HANDLE_VALUE) voro_fatal_error("Unable to open file for mapping",VOROPP_FILE_ERROR);
+	LARGE_INTEGER sz;
+	if(!GetFileSizeEx(fh,&sz)) voro_fatal_error("Unable to determine file size",VOROPP_FILE_ERROR);
+	size=size_t(sz.QuadPart);
+	if(size==0) {mh=NULL;data=NULL;return;}
+	mh=CreateFileMappingA(fh,NULL,PAGE_READONLY,0,0,NULL);
+	if(mh==NULL) voro_fatal_error("Unable to map file",VOROPP_FILE_ERROR);
+	data=static_cast<const char*>(MapViewOfFile(mh,FILE_MAP_READ,0,0,0));
+	if(data==NULL) voro_fatal_error("Unable to map file",VOROPP_FILE_ERROR);
+#else
+	fd=open(filename,O_RDONLY);
+	if(fd==-1) voro_fatal_error("Unable to open file for mapping",VOROPP_FILE_ERROR);
+	struct stat st;
+	if(fstat(fd,&st)==-1) voro_fatal_error("Unable to determine file size",VOROPP_FILE_ERROR);
+	size=size_t(st.st_size);
+	if(size==0) {data=NULL;return;}
+	void *m=mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+	if(m==MAP_FAILED) voro_fatal_error("Unable to map file",VOROPP_FILE_ERROR);
+	madvise(m,size,MADV_SEQUENTIAL);
+	data=static_cast<const char*>(m);
+#endif
+}
+
+/** The class destructor unmaps the file and closes it. */
+mapped_file_2d::~mapped_file_2d() {
+#ifdef _WIN32
+	if(data!=NULL) UnmapViewOfFile(data);
+	if(mh!=NULL) CloseHandle(mh);
+	CloseHandle(fh);
+#else
+	if(data!=NULL) munmap(const_cast<char*>(data),size);
+	close(fd);
+#endif
+}
+
+/** The class constructor sets up a stream on an already open file, and reads
+ * the header from it.
+ * \param[in] fp_ the file handle to read from.
+ * \param[in] chunk_ the maximum number of records to read at a time. */
+particle_stream_2d::particle_stream_2d(FILE *fp_,int chunk_)
+	: buf(NULL), count(0), fp(fp_), owner(false), chunk(chunk_), nread(0) {
+	setup();
+}
+
+/** The class constructor opens a file, and reads the header from it.
+ * \param[in] filename the name of the file to open.
+ * \param[in] chunk_ the maximum number of records to read at a time. */
+particle_stream_2d::particle_stream_2d(const char *filename,int chunk_)
+	: buf(NULL), count(0), fp(safe_fopen(filename,"rb")), owner(true), chunk(chunk_), nread(0) {
+	setup();
+}
+
+/** The class destructor frees the chunk buffer, and closes the file if it was
+ * opened by the class. */
+particle_stream_2d::~particle_stream_2d() {
+	delete [] buf;
+	if(owner) fclose(fp);
+}
+
+/** Reads and checks the file header, and allocates the chunk buffer. */
+void particle_stream_2d::setup() {
+	if(fread(&h,sizeof(binary_particle_header_2d),1,fp)!=1)
+		voro_fatal_error("Binary import error - can't read header",VOROPP_FILE_ERROR);
+	h.check();
+	buf=new char[size_t(chunk)*h.rsize];
+}
+
+/** Reads the next chunk of records into the buffer.
+ * \return True if any records were read, false if the end of the file has
+ * been reached. */
+bool particle_stream_2d::next_chunk() {
+	long long r=h.n-nread;
+	count=r<chunk?int(r):chunk;
+	if(count==0) return false;
+	if(fread(buf,h.rsize,count,fp)!=size_t(count))
+		voro_fatal_error("Binary import error - file is truncated",VOROPP_FILE_ERROR);
+	nread+=count;
+	return true;
+}
+
+/** Sets up a header for a tessellation file with no records.
+ * \param[in] flags_ the flags describing the record layout. */
+void binary_tessellation_header_2d::init(unsigned int flags_) {
+	magic=binary_tessellation_magic;
+	version=binary_tessellation_version;
+	flags=flags_;
+	reserved=0;
+	n=nv=0;
+	index=sizeof(binary_tessellation_header_2d);
+}
+
+/** Checks that a tessellation header that has been read from a file is valid.
+ * If it is not, then the routine causes a fatal error.
+ * \param[in] size the size of the file in bytes. */
+void binary_tessellation_header_2d::check(size_t size) {
+	if(magic!=binary_tessellation_magic) voro_fatal_error("Binary import error - not a binary tessellation file",VOROPP_FILE_ERROR);
+	if(version!=binary_tessellation_version) voro_fatal_error("Binary import error - unsupported file version",VOROPP_FILE_ERROR);
+	if(n<0||nv<0||index<(long long) sizeof(binary_tessellation_header_2d)) voro_fatal_error("Binary import error - corrupt header",VOROPP_FILE_ERROR);
+	if(n>(long long) size/8||(long long) size-8*n<index) voro_fatal_error("Binary import error - file is truncated",VOROPP_FILE_ERROR);
+}
+
+/** The class constructor writes a provisional header to the file stream.
+ * \param[in] fp_ the file handle to write to, which must be seekable.
+ * \param[in] flags_ the flags describing the record layout. */
+tessellation_writer_2d::tessellation_writer_2d(FILE *fp_,unsigned int flags_)
+	: fp(fp_), hpos(ftell(fp_)), pos(sizeof(binary_tessellation_header_2d)), ob(fp_) {
+	if(hpos==-1) voro_fatal_error("Binary export error - file is not seekable",VOROPP_FILE_ERROR);
+	h.init(flags_);
+	ob.put(reinterpret_cast<char*>(&h),sizeof(binary_tessellation_header_2d));
+}
+
+/** Appends the record of a Voronoi cell. The vertices are written in
+ * counter-clockwise order, by following the edges of the cell.
+ * \param[in] c a reference to the Voronoi cell.
+ * \param[in] i the ID of the particle associated with the cell.
+ * \param[in] (x,y) the position of the particle. */
+void tessellation_writer_2d::add(voronoicell_base_2d &c,int i,double x,double y) {
+	static const char zero[8]={0,0,0,0,0,0,0,0};
+	char rec[48];
+	double d[5];
+	int k=0,l=0,pad;
+	float f[2];
+
+	// Write the fixed-size part of the record
+	offs.push_back(pos);
+	c.centroid(d[3],d[4]);
+	d[0]=x;d[1]=y;d[2]=c.area();d[3]+=x;d[4]+=y;
+	memcpy(rec,&i,4);memcpy(rec+4,&c.p,4);memcpy(rec+8,d,40);
+	ob.put(rec,48);
+	pos+=48;
+	if(c.p==0) {h.n++;return;}
+
+	// Write the vertices, following the edges around the cell
+	if(h.has_delta()) {
+		do {
+			f[0]=float(0.5*c.pts[2*k]);f[1]=float(0.5*c.pts[2*k+1]);
+			ob.put(reinterpret_cast<char*>(f),8);
+			k=c.ed[2*k];
+		} while(k!=0);
+		pos+=8*c.p;
+	} else {
+		do {
+			d[0]=x+0.5*c.pts[2*k];d[1]=y+0.5*c.pts[2*k+1];
+			ob.put(reinterpret_cast<char*>(d),16);
+			k=c.ed[2*k];
+		} while(k!=0);
+		pos+=16*c.p;
+	}
+
+	// Write the neighbors of the edges in the same order, and pad the
+	// record to a multiple of eight bytes
+	if(h.has_neighbors()) {
+		c.neighbors(vi);
+		do {
+			ob.put(reinterpret_cast<char*>(&vi[l]),4);
+			l=c.ed[2*l];
+		} while(l!=0);
+		pos+=4*c.p;
+		pad=int((8-(pos&7))&7);
+		ob.put(zero,pad);pos+=pad;
+	}
+	h.n++;h.nv+=c.p;
+}
+
+/** Appends the index of record offsets and rewrites the header with the final
+ * counts. No further records may be added after this routine is called. */
+void tessellation_writer_2d::finish() {
+	h.index=pos;
+	if(!offs.empty()) ob.put(reinterpret_cast<char*>(&offs[0]),8*int(offs.size()));
+	ob.flush();
+	if(fseek(fp,hpos,SEEK_SET)!=0) voro_fatal_error("Binary export error - file is not seekable",VOROPP_FILE_ERROR);
+	if(fwrite(&h,sizeof(binary_tessellation_header_2d),1,fp)!=1)
+		voro_fatal_error("Binary export error - can't write header",VOROPP_FILE_ERROR);
+	fseek(fp,0,SEEK_END);
+}
+
+/** The class constructor maps a binary tessellation file into memory and
+ * checks its header. It also checks that every record lies between the header
+ * and the index, so that the inline accessors can read the mapped data
+ * without any further bounds checks.
+ * \param[in] filename the name of the file to open. */
+tessellation_file_2d::tessellation_file_2d(const char *filename) : mf(filename) {
+	if(mf.size<sizeof(binary_tessellation_header_2d))
+		voro_fatal_error("Binary import error - can't read header",VOROPP_FILE_ERROR);
+	memcpy(&h,mf.data,sizeof(binary_tessellation_header_2d));
+	h.check(mf.size);
+	if(h.n>INT_MAX) voro_fatal_error("Binary import error - too many cells",VOROPP_FILE_ERROR);
+	index=mf.data+h.index;
+
+	// Check the offset and the vertex count of each record against the
+	// extent of the record area
+	long long ro,re,nv=0;
+	int i,p;
+	for(i=0;i<int(h.n);i++) {
+		memcpy(&ro,index+8*i,8);
+		if(ro<(long long) sizeof(binary_tessellation_header_2d)||ro>h.index-48)
+			voro_fatal_error("Binary import error - corrupt index",VOROPP_FILE_ERROR);
+		memcpy(&p,mf.data+ro+4,4);
+		if(p<0||p>(h.index-ro-48)/8)
+			voro_fatal_error("Binary import error - corrupt cell record",VOROPP_FILE_ERROR);
+		re=ro+48+(long long) p*((h.has_delta()?8:16)+(h.has_neighbors()?4:0));
+		if(re>h.index) voro_fatal_error("Binary import error - corrupt cell record",VOROPP_FILE_ERROR);
+		nv+=p;
+	}
+	if(nv!=h.nv) voro_fatal_error("Binary import error - corrupt header",VOROPP_FILE_ERROR);
+}
+
+}
@@ -0,0 +1,305 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file binary_io_2d.h
+ * \brief Header file for the binary particle and tessellation file formats
+ * and the classes used to read and write them. */
+
+#ifndef VOROPP_BINARY_IO_2D_HH
+#define VOROPP_BINARY_IO_2D_HH
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#include "config.h"
+#include "common.h"
+#include "cell_2d.h"
+#include "format_2d.h"
+
+namespace voro {
+
+/** The magic number at the start of a binary particle file, which reads as
+ * "VP2D" in a little-endian byte dump. */
+const unsigned int binary_particle_magic=0x44325056;
+
+/** The version of the binary particle file format written by this code. */
+const unsigned int binary_particle_version=1;
+
+/** A flag in the binary particle header signalling that every record carries a
+ * radius after its position. */
+const unsigned int binary_particle_radius=1;
+
+/** The magic number at the start of a binary tessellation file, which reads
+ * as "VT2D" in a little-endian byte dump. */
+const unsigned int binary_tessellation_magic=0x44325456;
+
+/** The version of the binary tessellation file format written by this code. */
+const unsigned int binary_tessellation_version=1;
+
+/** A flag for binary tessellation files signalling that every cell record
+ * carries the IDs of its neighbors. */
+const unsigned int binary_tessellation_neighbors=1;
+
+/** A flag for binary tessellation files signalling that the vertices are
+ * stored as single-precision offsets from the particle position, rather than
+ * as double-precision global coordinates. */
+const unsigned int binary_tessellation_delta=2;
+
+/** \brief The header at the start of a binary particle file.
+ *
+ * A binary particle file consists of this 24 byte header, followed by n
+ * packed records. Each record holds a 32-bit particle ID and the x and y
+ * positions as 64-bit doubles, optionally followed by a 64-bit radius, with
+ * no padding between fields. All values are stored in the native byte order
+ * of the machine, which is little-endian on all supported platforms. */
+struct binary_particle_header_2d {
+	/** The magic number, set to binary_particle_magic. */
+	unsigned int magic;
+	/** The file format version. */
+	unsigned int version;
+	/** A bit field of flags describing the record layout. */
+	unsigned int flags;
+	/** The size of a single record in bytes. */
+	unsigned int rsize;
+	/** The number of records that follow the header. */
+	long long n;
+	void init(bool radius);
+	void check();
+	/** Returns whether the records carry a radius. */
+	inline bool has_radius() {return (flags&binary_particle_radius)!=0;}
+};
+
+/** \brief A read-only memory mapping of an entire file.
+ *
+ * This class maps a file into the address space of the process so that large
+ * binary particle files can be read without copying them through the C
+ * standard I/O buffers. The operating system pages the data in on demand. If
+ * the file cannot be opened or mapped, then the routine causes a fatal
+ * error. */
+class mapped_file_2d {
+	public:
+		/** A pointer to the start of the mapped data. */
+		const char *data;
+		/** The size of the mapped data in bytes. */
+		size_t size;
+		mapped_file_2d(const char *filename);
+		~mapped_file_2d();
+	private:
+#ifdef _WIN32
+		void *fh;
+		void *mh;
+#else
+		int fd;
+#endif
+};
+
+/** \brief A class for reading a binary particle file in fixed-size chunks.
+ *
+ * Memory mapping a file requires address space for all of it, and touching
+ * every page leaves the whole file in the page cache. This class instead
+ * reads a binary particle file sequentially through a fixed buffer, so that
+ * files larger than the available memory can be processed chunk by chunk. */
+class particle_stream_2d {
+	public:
+		/** The header read from the start of the file. */
+		binary_particle_header_2d h;
+		/** A pointer to the buffer holding the records of the current
+		 * chunk. */
+		char *buf;
+		/** The number of records in the current chunk. */
+		int count;
+		particle_stream_2d(FILE *fp_,int chunk_=init_stream_chunk);
+		particle_stream_2d(const char *filename,int chunk_=init_stream_chunk);
+		~particle_stream_2d();
+		bool next_chunk();
+		/** Returns the total number of records remaining to be read
+		 * after the current chunk. */
+		inline long long remaining() {return h.n-nread;}
+	private:
+		/** The file handle to read from. */
+		FILE *fp;
+		/** Whether the file was opened by the class, and therefore
+		 * needs to be closed by it. */
+		const bool owner;
+		/** The maximum number of records in a chunk. */
+		const int chunk;
+		/** The number of records read so far. */
+		long long nread;
+		void setup();
+};
+
+/** \brief The header at the start of a binary tessellation file.
+ *
+ * A binary tessellation file consists of this 40 byte header, followed by one
+ * record per Voronoi cell, followed by an index of n 64-bit byte offsets
+ * giving the start of each record. A record starts with the 32-bit particle ID
+ * and the 32-bit vertex count, followed by five doubles holding the particle
+ * position, the cell area, and the global centroid. The vertices then follow
+ * in counter-clockwise order, either as pairs of doubles in global
+ * coordinates, or as pairs of floats relative to the particle position if the
+ * delta flag is set. The delta form is lossy, keeping only the single
+ * precision of the offsets. If the neighbor flag is set, the record ends with one
+ * 32-bit neighbor ID per edge, where edge k joins vertex k to vertex k+1.
+ * Every record is padded to a multiple of eight bytes, so that the doubles in
+ * a mapped file are aligned. */
+struct binary_tessellation_header_2d {
+	/** The magic number, set to binary_tessellation_magic. */
+	unsigned int magic;
+	/** The file format version. */
+	unsigned int version;
+	/** A bit field of flags describing the record layout. */
+	unsigned int flags;
+	/** Reserved for future use, and set to zero. */
+	unsigned int reserved;
+	/** The number of cell records. */
+	long long n;
+	/** The total number of vertices in all cell records. */
+	long long nv;
+	/** The byte offset of the index from the start of the file. */
+	long long index;
+	void init(unsigned int flags_);
+	void check(size_t size);
+	/** Returns whether the records carry neighbor IDs. */
+	inline bool has_neighbors() {return (flags&binary_tessellation_neighbors)!=0;}
+	/** Returns whether the vertices are stored as single-precision
+	 * offsets. */
+	inline bool has_delta() {return (flags&binary_tessellation_delta)!=0;}
+};
+
+/** \brief A class for writing a binary tessellation file in a single pass.
+ *
+ * The cell records are streamed through an output buffer as the cells are
+ * computed, while the byte offsets of the records are collected in memory.
+ * When the tessellation is finished, the index is appended and the header is
+ * rewritten with the final counts, so the file stream must be seekable. */
+class tessellation_writer_2d {
+	public:
+		tessellation_writer_2d(FILE *fp_,unsigned int flags_);
+		void add(voronoicell_base_2d &c,int i,double x,double y);
+		void finish();
+		/** Returns whether the records carry neighbor IDs, in which
+		 * case the cells passed to add() must be of a class that
+		 * tracks neighbor information. */
+		inline bool neighbor() {return h.has_neighbors();}
+	private:
+		/** The header, which is updated as records are added. */
+		binary_tessellation_header_2d h;
+		/** The file handle to write to. */
+		FILE *fp;
+		/** The file position of the header. */
+		long hpos;
+		/** The byte offset of the next record from the header. */
+		long long pos;
+		/** The byte offsets of the records written so far. */
+		vector<long long> offs;
+		/** The buffer that the records are written through. */
+		output_buffer_2d ob;
+		/** Temporary storage for the neighbor IDs of a cell. */
+		vector<int> vi;
+};
+
+/** \brief Read-only access to a memory-mapped binary tessellation file.
+ *
+ * The file is mapped into memory in its entirety and the cell records are
+ * accessed in place through the index, so a tessellation can be loaded
+ * without any parsing. If the file is not a valid binary tessellation file,
+ * then the constructor causes a fatal error. */
+class tessellation_file_2d {
+	public:
+		/** The header read from the start of the file. */
+		binary_tessellation_header_2d h;
+		tessellation_file_2d(const char *filename);
+		/** Returns the number of cells in the file. */
+		inline int cells() {return int(h.n);}
+		/** Returns the ID of the particle of a cell.
+		 * \param[in] i the index of the cell. */
+		inline int id(int i) {return get<int>(i,0);}
+		/** Returns the number of vertices of a cell.
+		 * \param[in] i the index of the cell. */
+		inline int vertices(int i) {return get<int>(i,4);}
+		/** Returns the position of the particle of a cell.
+		 * \param[in] i the index of the cell.
+		 * \param[out] (x,y) the position. */
+		inline void position(int i,double &x,double &y) {
+			x=get<double>(i,8);y=get<double>(i,16);
+		}
+		/** Returns the area of a cell.
+		 * \param[in] i the index of the cell. */
+		inline double area(int i) {return get<double>(i,24);}
+		/** Returns the centroid of a cell in global coordinates.
+		 * \param[in] i the index of the cell.
+		 * \param[out] (cx,cy) the centroid. */
+		inline void centroid(int i,double &cx,double &cy) {
+			cx=get<double>(i,32);cy=get<double>(i,40);
+		}
+		/** Returns the global position of a vertex of a cell.
+		 * \param[in] i the index of the cell.
+		 * \param[in] k the index of the vertex.
+		 * \param[out] (vx,vy) the position of the vertex. */
+		inline void vertex(int i,int k,double &vx,double &vy) {
+			if(h.has_delta()) {
+				vx=get<double>(i,8)+get<float>(i,48+8*k);
+				vy=get<double>(i,16)+get<float>(i,52+8*k);
+			} else {
+				vx=get<double>(i,48+16*k);vy=get<double>(i,56+16*k);
+			}
+		}
+		/** Returns the neighbor ID across an edge of a cell, which is
+		 * only available if the file carries neighbor information.
+		 * \param[in] i the index of the cell.
+		 * \param[in] k the index of the edge. */
+		inline int neighbor(int i,int k) {
+			return get<int>(i,48+(h.has_delta()?8:16)*vertices(i)+4*k);
+		}
+	private:
+		/** The mapping of the file. */
+		mapped_file_2d mf;
+		/** A pointer to the index of record offsets. */
+		const char *index;
+		/** Reads a value from a cell record.
+		 * \param[in] i the index of the cell.
+		 * \param[in] o the byte offset of the value within the
+		 *              record. */
+		template<class t>
+		inline t get(int i,int o) {
+			long long ro;t v;
+			memcpy(&ro,index+8*i,8);
+			memcpy(&v,mf.data+ro+o,sizeof(t));
+			return v;
+		}
+};
+
+void write_binary_particle_header(binary_particle_header_2d &h,FILE *fp);
+void rewrite_binary_particle_header(binary_particle_header_2d &h,long pos,FILE *fp);
+
+/** Appends a single particle record to an open binary particle file.
+ * \param[in] n the numerical ID of the particle.
+ * \param[in] (x,y) the position of the particle.
+ * \param[in] fp the file handle to write to. */
+inline void write_binary_particle(int n,double x,double y,FILE *fp) {
+	char rec[20];
+	memcpy(rec,&n,4);memcpy(rec+4,&x,8);memcpy(rec+12,&y,8);
+	fwrite(rec,20,1,fp);
+}
+
+/** Appends a single particle record with a radius to an open binary particle
+ * file.
+ * \param[in] n the numerical ID of the particle.
+ * \param[in] (x,y) the position of the particle.
+ * \param[in] r the radius of the particle.
+ * \param[in] fp the file handle to write to. */
+inline void write_binary_particle(int n,double x,double y,double r,FILE *fp) {
+	char rec[28];
+	memcpy(rec,&n,4);memcpy(rec+4,&x,8);memcpy(rec+12,&y,8);memcpy(rec+20,&r,8);
+	fwrite(rec,28,1,fp);
+}
+
+}
+
+#endif
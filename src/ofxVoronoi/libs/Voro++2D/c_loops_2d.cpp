@@ -9,6 +9,8 @@
 
 #include "c_loops_2d.h"
 
+#include <algorithm>
+
 namespace voro {
 
 /** Initializes a c_loop_subset_2d object to scan over all particles within a
@@ -120,6 +122,21 @@ bool c_loop_subset_2d::next_block() {
 	} else return false;
 }
 
+/** Computes the order in which a c_loop_hilbert_2d object visits the blocks,
+ * by sorting the blocks by their index along a Hilbert curve that covers the
+ * smallest square power-of-two grid containing them. */
+void c_loop_hilbert_2d::setup_order() {
+	unsigned int m=1;
+	int l;
+	while(m<(unsigned int) nx||m<(unsigned int) ny) m<<=1;
+	unsigned long long *key=new unsigned long long[nxy];
+	for(l=0;l<nxy;l++)
+		key[l]=((unsigned long long) hilbert_index_2d(m,l%nx,l/nx)<<32)|(unsigned int) l;
+	sort(key,key+nxy);
+	for(l=0;l<nxy;l++) bo[l]=int(key[l]&0xffffffffu);
+	delete [] key;
+}
+
 /** Extends the memory available for storing the ordering. */
 void particle_order::add_ordering_memory() {
 	int *no=new int[size<<2],*nop=no,*opp=o;
@@ -4,6 +4,8 @@
 
 #include "cell_2d.h"
 #include "cell_nc_2d.h"
+#include "format_2d.h"
+#include "counters_2d.h"
 
 namespace voro {
 
@@ -126,6 +128,7 @@ template<class vc_class>
 bool voronoicell_base_2d::nplane(vc_class &vc,double x,double y,double rsq,int p_id) {
 	int up=0,up2,up3;
 	double u,u2,u3;
+	VOROPP_COUNT(nplane);
 
 	// First try and find a vertex that is within the cutting plane, if
 	// there is one. If one can't be found, then the cell is not cut by
@@ -159,6 +162,7 @@ template<class vc_class>
 bool voronoicell_base_2d::nplane_cut(vc_class &vc,double x,double y,double rsq,int p_id,double u,int up) {
 	int cp,lp,up2,up3,*stackp=ds;
 	double fac,l,u2,u3;
+	VOROPP_COUNT(nplane_cut);
 
 	// Add this point to the delete stack, and search counter-clockwise to
 	// find additional points that need to be deleted.
@@ -396,62 +400,9 @@ void voronoicell_base_2d::centroid(double &cx,double &cy) {
  * \param[in] r a radius associated with the particle.
  * \param[in] fp the file handle to write to. */
 void voronoicell_base_2d::output_custom(const char *format,int i,double x,double y,double r,FILE *fp) {
-	char *fmp(const_cast<char*>(format));
-	vector<int> vi;
-	vector<double> vd;
-	while(*fmp!=0) {
-		if(*fmp=='%') {
-			fmp++;
-			switch(*fmp) {
-
-				// Particle-related output
-				case 'i': fprintf(fp,"%d",i);break;
-				case 'x': fprintf(fp,"%g",x);break;
-				case 'y': fprintf(fp,"%g",y);break;
-				case 'q': fprintf(fp,"%g %g",x,y);break;
-				case 'r': fprintf(fp,"%g",r);break;
-
-				// Vertex-related output
-				case 'w': fprintf(fp,"%d",p);break;
-				case 'p': output_vertices(fp);break;
-				case 'P': output_vertices(x,y,fp);break;
-				case 'm': fprintf(fp,"%g",0.25*max_radius_squared());break;
-
-				// Edge-related output
-				case 'g': fprintf(fp,"%d",p);break;
-				case 'E': fprintf(fp,"%g",perimeter());break;
-				case 'e': edge_lengths(vd);voro_print_vector(vd,fp);break;
-				case 'l': normals(vd);
-					  voro_print_positions_2d(vd,fp);
-					  break;
-				case 'n': neighbors(vi);
-					  voro_print_vector(vi,fp);
-					  break;
-
-				// Area-related output
-				case 'a': fprintf(fp,"%g",area());break;
-				case 'c': {
-						  double cx,cy;
-						  centroid(cx,cy);
-						  fprintf(fp,"%g %g",cx,cy);
-					  } break;
-				case 'C': {
-						  double cx,cy;
-						  centroid(cx,cy);
-						  fprintf(fp,"%g %g",x+cx,y+cy);
-					  } break;
-
-				// End-of-string reached
-				case 0: fmp--;break;
-
-				// The percent sign is not part of a
-				// control sequence
-				default: putc('%',fp);putc(*fmp,fp);
-			}
-		} else putc(*fmp,fp);
-		fmp++;
-	}
-	fputs("\n",fp);
+	custom_format_2d cf(format);
+	output_buffer_2d ob(fp,256);
+	cf.output(*this,i,x,y,r,ob);
 }
 
 /** Doubles the storage for the vertices, by reallocating the pts and ed
@@ -464,6 +415,7 @@ void voronoicell_base_2d::add_memory_vertices(vc_class &vc) {
 
 	// Double the memory allocation and check it is within range
 	current_vertices<<=1;
+	VOROPP_COUNT(vertex_growth);
 	if(current_vertices>max_vertices) voro_fatal_error("Vertex memory allocation exceeded absolute maximum",VOROPP_MEMORY_ERROR);
 #if VOROPP_VERBOSE >=2
 	fprintf(stderr,"Vertex memory scaled up to %d\n",current_vertices);
@@ -505,6 +457,7 @@ void voronoicell_neighbor_2d::init(double xmin,double xmax,double ymin,double ym
  * \param[in] stackp a reference to the current stack pointer. */
 void voronoicell_base_2d::add_memory_ds(int *&stackp) {
 	current_delete_size<<=1;
+	VOROPP_COUNT(delete_growth);
 	if(current_delete_size>max_delete_size) voro_fatal_error("Delete stack 1 memory allocation exceeded absolute maximum",VOROPP_MEMORY_ERROR);
 #if VOROPP_VERBOSE >=2
 	fprintf(stderr,"Delete stack 1 memory scaled up to %d\n",current_delete_size);
@@ -9,6 +9,7 @@
  * \brief Function implementations for the non-convex 2D Voronoi classes. */
 
 #include "cell_nc_2d.h"
+#include "counters_2d.h"
 
 namespace voro {
 
@@ -76,6 +77,7 @@ template<class vc_class>
 bool voronoicell_nonconvex_base_2d::nplane_nonconvex(vc_class &vc,double x,double y,double rsq,int p_id) {
 	int up=0,*edd;
 	double u,rx,ry,sx,sy;
+	VOROPP_COUNT(nplane);
 
 	if(x*(*reg)+y*reg[1]<0) {edd=ed;rx=reg[2];ry=reg[3];sx=*reg;sy=reg[1];}
 	else {edd=ed+1;rx=reg[4];ry=reg[5];sx=-*reg;sy=-reg[1];}
@@ -11,6 +11,35 @@ const int init_vertices=256;
 const int init_delete_size=256;
 /** The default initial size for the ordering class. */
 const int init_ordering_size=4096;
+/** The default number of records read at a time by the binary particle
+ * stream class. */
+const int init_stream_chunk=65536;
+/** The default size in bytes of the buffer used for custom output. */
+const int init_output_buffer_size=1<<20;
+/** The total size in bytes of the buffers that the tiled tessellation driver
+ * collects each tile's particles in, before appending them to its spill file
+ * as a block. */
+const int tile_spill_buffer=1<<24;
+/** The minimum number of particles in a block of the tiled tessellation
+ * driver's spill file. */
+const int min_tile_block=64;
+/** The target mean number of particles per block, used when the tiled
+ * tessellation driver chooses the block grid of a tile's container. */
+const double optimal_particles_2d=4;
+/** The number of particles that a thread takes from its range at a time in
+ * the parallel cell computations. */
+const int schedule_grain_2d=16;
+/** The maximum number of steps that the Voronoi locator takes when walking
+ * towards a query point, before it falls back to a grid search. */
+const int max_locator_walk_2d=64;
+/** The smallest and largest number of cells along each side of the coarse
+ * grid that the Voronoi locator sorts a batch of queries on. Between these,
+ * the grid has about one cell per particle. Both must be powers of two. */
+const int locator_batch_min_grid=16;
+const int locator_batch_max_grid=256;
+/** A batch of queries is only sorted if more than one in this many
+ * successive pairs lie in coarse grid cells that are not adjacent. */
+const int locator_batch_jumps=16;
 
 const int init_boundary_size=256;
 const int init_wall_tag_size=6;
@@ -45,6 +74,14 @@ const int max_particle_memory_2d=16777216;
 #define VOROPP_VERBOSE 1
 #endif
 
+#ifndef VOROPP_COUNTERS
+/** If this is set to 1, then the library counts internal operations such as
+ * plane cuts, block scans, and memory growth events, which can be read with
+ * collect_counters_2d(). This requires C++11 thread_local support. When it is
+ * set to 0, the counters compile away entirely. */
+#define VOROPP_COUNTERS 0
+#endif
+
 /** A radius to use as a placeholder when no other information is available. */
 const double default_radius=0.5;
 
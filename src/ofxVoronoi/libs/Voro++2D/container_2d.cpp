@@ -7,7 +7,10 @@
 /** \file container_2d.cc
  * \brief Function implementations for the container_2d and related classes. */
 
+#include <climits>
+
 #include "container_2d.h"
+#include "metrics_2d.h"
 
 namespace voro {
 
@@ -60,7 +63,16 @@ container_base_2d::~container_base_2d() {
 container_2d::container_2d(double ax_,double bx_,double ay_,double by_,
 	int nx_,int ny_,bool xperiodic_,bool yperiodic_,int init_mem)
 	: container_base_2d(ax_,bx_,ay_,by_,nx_,ny_,xperiodic_,yperiodic_,init_mem,2),
-	vc(*this,xperiodic_?2*nx_+1:nx_,yperiodic_?2*ny_+1:ny_) {}
+	vc(*this,xperiodic_?2*nx_+1:nx_,yperiodic_?2*ny_+1:ny_), track(false), tvisit(0),
+	cco(NULL), ovf(NULL) {}
+
+/** The class destructor frees any memory left over from a concurrent insertion
+ * that was not finished. */
+container_2d::~container_2d() {
+	concurrent_particle_2d *cp=ovf.load(),*np;
+	while(cp!=NULL) {np=cp->next;delete cp;cp=np;}
+	delete [] cco;
+}
 
 /** The class constructor sets up the geometry of container.
  * \param[in] (ax_,bx_) the minimum and maximum x coordinates.
@@ -82,6 +94,7 @@ void container_2d::put(int n,double x,double y) {
 	int ij;
 	if(put_locate_block(ij,x,y)) {
 		//totpar++;
+		if(track) track_put(n,x,y,ij);
 		id[ij][co[ij]]=n;
 		double *pp=p[ij]+2*co[ij]++;
 		*(pp++)=x;*pp=y;
@@ -112,6 +125,7 @@ void container_2d::put(particle_order &vo,int n,double x,double y) {
 	int ij;
 	if(put_locate_block(ij,x,y)) {
 		//totpar++;
+		if(track) track_put(n,x,y,ij);
 		id[ij][co[ij]]=n;
 		vo.add(ij,co[ij]);
 		double *pp=p[ij]+2*co[ij]++;
@@ -181,6 +195,96 @@ inline bool container_base_2d::put_remap(int &ij,double &x,double &y) {
 	return true;
 }
 
+/** Prepares the container for particles to be put into it from several threads
+ * at once with put_concurrent(). Each block is given room for twice its
+ * expected share of the new particles, and a counter of its claimed slots that
+ * is incremented atomically. If a sample of positions is given, such as every
+ * k-th of the particles to be added or the particles of a previous frame, then
+ * the shares follow the density of the sample, and otherwise the particles are
+ * assumed to be spread uniformly. Dynamic editing cannot be enabled.
+ * \param[in] n the expected number of particles to be added.
+ * \param[in] sample a pointer to the sample positions, as (x,y) pairs, or NULL
+ *                   for no sample.
+ * \param[in] ns the number of sample positions. */
+void container_2d::begin_concurrent(int n,const double *sample,int ns) {
+	if(track) voro_fatal_error("Concurrent insertion cannot be used with dynamic editing",VOROPP_INTERNAL_ERROR);
+	if(cco!=NULL) voro_fatal_error("Concurrent insertion has already been started",VOROPP_INTERNAL_ERROR);
+	int ij,l,extra,*sc=NULL;
+	double x,y;
+
+	// Count the sample positions in each block
+	if(sample!=NULL&&ns>0) {
+		sc=new int[nxy];
+		for(ij=0;ij<nxy;ij++) sc[ij]=0;
+		for(l=0;l<ns;l++) {
+			x=sample[2*l];y=sample[2*l+1];
+			if(put_remap(ij,x,y)) sc[ij]++;
+		}
+	}
+
+	cco=new atomic<int>[nxy];
+	for(ij=0;ij<nxy;ij++) {
+		extra=sc==NULL?2*(n/nxy)+1:int(2.0*n*sc[ij]/ns)+2;
+		if(co[ij]+extra>mem[ij]) reserve_particle_memory(ij,co[ij]+extra);
+		cco[ij].store(co[ij],memory_order_relaxed);
+	}
+	delete [] sc;
+}
+
+/** Puts a particle into the container during concurrent insertion. This can be
+ * called from several threads at once, and takes no locks. The particle claims
+ * the next slot of its block, and if the block is full, it is pushed onto a
+ * list of particles that are added once the insertion is finished. The order
+ * of the particles within each block depends on the timing of the threads.
+ * \param[in] n the numerical ID of the inserted particle.
+ * \param[in] (x,y) the position vector of the inserted particle. */
+void container_2d::put_concurrent(int n,double x,double y) {
+	int ij,q;
+	if(!put_remap(ij,x,y)) {
+#if VOROPP_REPORT_OUT_OF_BOUNDS ==1
+		fprintf(stderr,"Out of bounds: (x,y)=(%g,%g)\n",x,y);
+#endif
+		return;
+	}
+	q=cco[ij].fetch_add(1,memory_order_relaxed);
+	if(q<mem[ij]) {
+		id[ij][q]=n;
+		double *pp=p[ij]+2*q;
+		*(pp++)=x;*pp=y;
+	} else {
+		concurrent_particle_2d *cp=new concurrent_particle_2d;
+		cp->n=n;cp->x=x;cp->y=y;
+		cp->next=ovf.load(memory_order_relaxed);
+		while(!ovf.compare_exchange_weak(cp->next,cp,memory_order_release,memory_order_relaxed));
+	}
+}
+
+/** Finishes a concurrent insertion, by setting the number of particles in each
+ * block and adding the particles that did not fit. This must only be called
+ * once all of the threads calling put_concurrent() have finished. */
+void container_2d::end_concurrent() {
+	if(cco==NULL) voro_fatal_error("Concurrent insertion has not been started",VOROPP_INTERNAL_ERROR);
+	int ij,c;
+	for(ij=0;ij<nxy;ij++) {
+		c=cco[ij].load(memory_order_relaxed);
+		co[ij]=c<mem[ij]?c:mem[ij];
+	}
+	delete [] cco;cco=NULL;
+
+	// Add the particles that did not fit in bulk, so that each block is
+	// grown at most once
+	concurrent_particle_2d *cp=ovf.exchange(NULL,memory_order_acquire),*np;
+	vector<char> rec;
+	char *rp;
+	for(;cp!=NULL;cp=np) {
+		rec.resize(rec.size()+20);
+		rp=&rec[rec.size()-20];
+		memcpy(rp,&cp->n,4);memcpy(rp+4,&cp->x,8);memcpy(rp+12,&cp->y,8);
+		np=cp->next;delete cp;
+	}
+	if(!rec.empty()) put_records(&rec[0],int(rec.size()/20),20,NULL);
+}
+
 /** Takes a position vector and attempts to remap it into the primary domain.
  * \param[out] (ai,aj) the periodic image displacement that the vector is in,
  *                     with (0,0,0) corresponding to the primary domain.
@@ -244,6 +348,221 @@ bool container_2d::find_voronoi_cell(double x,double y,double &rx,double &ry,int
 	return false;
 }
 
+/** Enables dynamic editing of the container. An index from particle IDs to
+ * their locations in the block structure is built, which requires that all
+ * IDs are non-negative and unique, and every particle is marked as needing its
+ * cell to be computed. From then on, the index is kept up to date as particles
+ * are added, and particles can be removed or moved individually in constant
+ * time. When a particle is added, removed, or moved, the particles whose cells
+ * could change are marked as dirty. This uses the neighbor lists and vertex
+ * distances of the cells recorded with record_cell(), so that only the cells
+ * that are affected need to be recomputed. */
+void container_2d::enable_tracking() {
+	int ij,q,n,mid=-1;
+	if(cco!=NULL) voro_fatal_error("Dynamic editing cannot be enabled during concurrent insertion",VOROPP_INTERNAL_ERROR);
+	track=true;
+	tr.clear();dirty.clear();
+	for(ij=0;ij<nxy;ij++) for(q=0;q<co[ij];q++) {
+		n=id[ij][q];
+		if(n<0) voro_fatal_error("Dynamic editing requires non-negative particle IDs",VOROPP_INTERNAL_ERROR);
+		if(n>mid) mid=n;
+	}
+	tr.resize(mid+1);
+	for(ij=0;ij<nxy;ij++) for(q=0;q<co[ij];q++) {
+		particle_track_2d &t=tr[id[ij][q]];
+		if(t.ij!=-1) voro_fatal_error("Dynamic editing requires unique particle IDs",VOROPP_INTERNAL_ERROR);
+		t.ij=ij;t.q=q;
+		mark_dirty(id[ij][q]);
+	}
+}
+
+/** Finds the location of a particle in the block structure. Dynamic editing
+ * must be enabled.
+ * \param[in] n the ID of the particle.
+ * \param[out] ij the block that the particle is within.
+ * \param[out] q the index of the particle within its block.
+ * \return True if the particle is in the container, false otherwise. */
+bool container_2d::find_particle(int n,int &ij,int &q) {
+	if(!track||n<0||n>=int(tr.size())||tr[n].ij==-1) return false;
+	ij=tr[n].ij;q=tr[n].q;
+	return true;
+}
+
+/** Removes a particle from the container, by moving the last particle in its
+ * block into its slot. The neighbors of the particle are marked as dirty.
+ * Dynamic editing must be enabled.
+ * \param[in] n the ID of the particle to remove.
+ * \return True if the particle was removed, false if it was not found. */
+bool container_2d::remove(int n) {
+	if(!track||n<0||n>=int(tr.size())||tr[n].ij==-1) return false;
+	particle_track_2d &t=tr[n];
+	mark_neighbors(t);
+	take_particle(t.ij,t.q);
+	t.ij=-1;t.reach=-1;t.ne.clear();
+	return true;
+}
+
+/** Moves a particle to a new position. The neighbors of the particle at its
+ * old position, the cells affected by it at its new position, and the particle
+ * itself are marked as dirty. Dynamic editing must be enabled.
+ * \param[in] n the ID of the particle to move.
+ * \param[in] (x,y) the new position of the particle.
+ * \return True if the particle was moved, false if it was not found or if the
+ * new position is outside the container, in which case the particle is
+ * removed. */
+bool container_2d::move(int n,double x,double y) {
+	if(!track||n<0||n>=int(tr.size())||tr[n].ij==-1) return false;
+	particle_track_2d &t=tr[n];
+	int ij;
+	mark_neighbors(t);
+	take_particle(t.ij,t.q);
+	t.ij=-1;
+	if(!put_locate_block(ij,x,y)) {t.reach=-1;t.ne.clear();return false;}
+	mark_insertion(x,y);
+	t.ij=ij;t.q=co[ij];
+	mark_dirty(n);
+	id[ij][co[ij]]=n;
+	double *pp=p[ij]+2*co[ij]++;
+	*(pp++)=x;*pp=y;
+	return true;
+}
+
+/** Reorders the particles within each block along a Hilbert curve, as
+ * described for container_base_2d::sort_hilbert(), and updates the locations
+ * of the particles if dynamic editing is enabled. */
+void container_2d::sort_hilbert() {
+	container_base_2d::sort_hilbert();
+	if(track) for(int ij=0;ij<nxy;ij++)
+		for(int q=0;q<co[ij];q++) tr[id[ij][q]].q=q;
+}
+
+/** Records the Voronoi cell of a particle, so that its neighbor list and
+ * maximum vertex distance can be used to find the cells affected by later
+ * edits. Dynamic editing must be enabled.
+ * \param[in] n the ID of the particle.
+ * \param[in] c the computed Voronoi cell of the particle. */
+void container_2d::record_cell(int n,voronoicell_neighbor_2d &c) {
+	if(!track||n<0||n>=int(tr.size())||tr[n].ij==-1) return;
+	c.neighbors(tr[n].ne);
+	tr[n].reach=c.max_radius_squared();
+}
+
+/** Transfers the particles whose cells need to be recomputed into an ordering
+ * class, which can then be used with a c_loop_order_2d to compute them, and
+ * clears the list. The ordering refers to block locations, and is therefore
+ * only valid until the next particle is removed or moved.
+ * \param[in,out] vo the ordering class to add the particles to. */
+void container_2d::take_dirty(particle_order &vo) {
+	for(vector<int>::iterator it=dirty.begin();it<dirty.end();it++) {
+		particle_track_2d &t=tr[*it];
+		if(!t.dirty) continue;
+		t.dirty=false;
+		if(t.ij!=-1) vo.add(t.ij,t.q);
+	}
+	dirty.clear();
+}
+
+/** Adds a particle to the index when it is put into the container, and marks
+ * the particle and the cells that it affects as dirty.
+ * \param[in] n the ID of the particle.
+ * \param[in] (x,y) the position of the particle.
+ * \param[in] ij the block that the particle is being put into. */
+void container_2d::track_put(int n,double x,double y,int ij) {
+	if(n<0) voro_fatal_error("Dynamic editing requires non-negative particle IDs",VOROPP_INTERNAL_ERROR);
+	if(n>=int(tr.size())) tr.resize(n>=2*int(tr.size())?n+1:2*tr.size());
+	else if(tr[n].ij!=-1) voro_fatal_error("Dynamic editing requires unique particle IDs",VOROPP_INTERNAL_ERROR);
+	mark_insertion(x,y);
+	particle_track_2d &t=tr[n];
+	t.ij=ij;t.q=co[ij];t.reach=-1;t.ne.clear();
+	mark_dirty(n);
+}
+
+/** Makes the record of a particle up to date. If the particle's cell is
+ * dirty, or has not been recorded, then its recorded neighbor list and vertex
+ * distance may not describe the current cell, so the cell is computed from
+ * the particles currently in the container and recorded again. The particle
+ * remains marked as dirty.
+ * \param[in] t the record of the particle. */
+void container_2d::refresh_record(particle_track_2d &t) {
+	if(!t.dirty&&t.reach>=0) return;
+	if(compute_cell(tcell,t.ij,t.q)) {
+		tcell.neighbors(t.ne);
+		t.reach=tcell.max_radius_squared();
+	} else {t.ne.clear();t.reach=0;}
+}
+
+/** Marks the particles whose cells could change when a particle is taken
+ * away, which are its neighbors.
+ * \param[in] t the record of the particle being taken away. */
+void container_2d::mark_neighbors(particle_track_2d &t) {
+	refresh_record(t);
+	for(vector<int>::iterator it=t.ne.begin();it<t.ne.end();it++)
+		if(*it>=0&&*it<int(tr.size())&&tr[*it].ij!=-1) {
+			mark_dirty(*it);
+			mark_coincident(tr[*it]);
+		}
+}
+
+/** Marks the other particles at exactly the same position as a particle.
+ * Their cells are identical, but only one of them appears in the neighbor
+ * lists of the surrounding cells, so they cannot be found by following the
+ * neighbor lists. They are always in the same block.
+ * \param[in] t the record of the particle. */
+void container_2d::mark_coincident(particle_track_2d &t) {
+	double *pp=p[t.ij]+2*t.q,*qp=p[t.ij];
+	for(int q=0;q<co[t.ij];q++,qp+=2)
+		if(q!=t.q&&*qp==*pp&&qp[1]==pp[1]) mark_dirty(id[t.ij][q]);
+}
+
+/** Marks the cells that would be cut by a particle inserted at a given
+ * position. The cut cells form a connected region around the cell that
+ * contains the position, so the search starts from that cell and spreads out
+ * through the neighbor lists of the cells that are cut. A cell is cut if the
+ * new particle is closer than twice the maximum distance to a vertex of the
+ * cell. Records that may be out of date are refreshed as they are reached.
+ * Particles at exactly the same position as a cut cell are marked along with
+ * it.
+ * \param[in] (x,y) the position of the new particle. */
+void container_2d::mark_insertion(double x,double y) {
+	int n,pid;
+	double rx,ry,dx,dy,*pp,wx=bx-ax,wy=by-ay;
+	tstack.clear();
+	if(find_voronoi_cell(x,y,rx,ry,pid)) tstack.push_back(pid);
+	tvisit++;
+	while(!tstack.empty()) {
+		n=tstack.back();tstack.pop_back();
+		if(n<0||n>=int(tr.size())) continue;
+		particle_track_2d &t=tr[n];
+		if(t.ij==-1||t.visit==tvisit) continue;
+		t.visit=tvisit;
+		refresh_record(t);
+		pp=p[t.ij]+2*t.q;
+		dx=*pp-x;dy=pp[1]-y;
+		if(xperiodic) dx-=wx*floor(dx/wx+0.5);
+		if(yperiodic) dy-=wy*floor(dy/wy+0.5);
+		if(dx*dx+dy*dy<t.reach+tolerance) {
+			mark_dirty(n);
+			for(vector<int>::iterator it=t.ne.begin();it<t.ne.end();it++)
+				if(*it>=0) tstack.push_back(*it);
+			mark_coincident(t);
+		}
+	}
+}
+
+/** Takes a particle out of its block, by moving the last particle in the
+ * block into its slot and updating the index for that particle.
+ * \param[in] ij the block that the particle is within.
+ * \param[in] q the index of the particle within its block. */
+void container_2d::take_particle(int ij,int q) {
+	int l=--co[ij];
+	if(q!=l) {
+		id[ij][q]=id[ij][l];
+		p[ij][2*q]=p[ij][2*l];
+		p[ij][2*q+1]=p[ij][2*l+1];
+		tr[id[ij][q]].q=q;
+	}
+}
+
 /** Takes a vector and finds the particle whose Voronoi cell contains that
  * vector. Additional wall classes are not considered by this routine.
  * \param[in] (x,y) the vector to test.
@@ -283,6 +602,7 @@ bool container_poly_2d::find_voronoi_cell(double x,double y,double &rx,double &r
  * \param[in] i the index of the region to reallocate. */
 void container_base_2d::add_particle_memory(int i) {
 	int l,nmem=mem[i]<<1;
+	VOROPP_COUNT(particle_growth);
 
 	// Carry out a check on the memory allocation size, and
 	// print a status message if requested
@@ -304,6 +624,197 @@ void container_base_2d::add_particle_memory(int i) {
 	delete [] p[i];p[i]=pp;
 }
 
+/** Increase memory for a particular region so that it can hold at least a
+ * given number of particles. The allocation is doubled as many times as
+ * necessary, so that a bulk insertion reallocates each region at most once.
+ * \param[in] i the index of the region to reallocate.
+ * \param[in] n the number of particles that the region must hold. */
+void container_base_2d::reserve_particle_memory(int i,int n) {
+	int l,nmem=mem[i];
+	while(nmem<n) {
+		nmem<<=1;
+		if(nmem>max_particle_memory_2d)
+			voro_fatal_error("Absolute maximum memory allocation exceeded",VOROPP_MEMORY_ERROR);
+	}
+	if(nmem==mem[i]) return;
+	VOROPP_COUNT(particle_growth);
+#if VOROPP_VERBOSE >=3
+	fprintf(stderr,"Particle memory in region %d scaled up to %d\n",i,nmem);
+#endif
+
+	// Allocate new memory and copy in the contents of the old arrays
+	int *idp=new int[nmem];
+	for(l=0;l<co[i];l++) idp[l]=id[i][l];
+	double *pp=new double[ps*nmem];
+	for(l=0;l<ps*co[i];l++) pp[l]=p[i][l];
+
+	// Update pointers and delete old arrays
+	mem[i]=nmem;
+	delete [] id[i];id[i]=idp;
+	delete [] p[i];p[i]=pp;
+}
+
+/** Reorders the particles within each block so that they are stored in the
+ * order of a Hilbert curve through the block, and reallocates the blocks in
+ * the order that c_loop_hilbert_2d visits them. Looping with that class then
+ * visits cells that are close together both in space and in memory, although
+ * this has not made computing the cells any faster than row order. Any
+ * particle_order objects that refer to the container are invalidated by this
+ * routine. */
+void container_base_2d::sort_hilbert() {
+	const unsigned int m=1<<10;
+	int i,j,ij,l,k,mx=0,bid,*idp;
+	unsigned int *key,bkey,fx,fy;
+	double bp[3],*pp,f;
+	for(ij=0;ij<nxy;ij++) if(co[ij]>mx) mx=co[ij];
+	key=new unsigned int[mx];
+	for(j=ij=0;j<ny;j++) for(i=0;i<nx;i++,ij++) {
+
+		// Compute the curve index of each particle, from its position
+		// relative to the block
+		idp=id[ij];pp=p[ij];
+		for(l=0;l<co[ij];l++) {
+			f=((pp[ps*l]-ax)*xsp-i)*m;fx=f<0?0:(f>=m?m-1:(unsigned int) f);
+			f=((pp[ps*l+1]-ay)*ysp-j)*m;fy=f<0?0:(f>=m?m-1:(unsigned int) f);
+			key[l]=hilbert_index_2d(m,fx,fy);
+		}
+
+		// Sort the particles by insertion, since there are only a few
+		// in each block
+		for(l=1;l<co[ij];l++) {
+			bkey=key[l];bid=idp[l];
+			for(k=0;k<ps;k++) bp[k]=pp[ps*l+k];
+			for(k=l;k>0&&key[k-1]>bkey;k--) {
+				key[k]=key[k-1];idp[k]=idp[k-1];
+				memcpy(pp+ps*k,pp+ps*(k-1),ps*sizeof(double));
+			}
+			key[k]=bkey;idp[k]=bid;
+			memcpy(pp+ps*k,bp,ps*sizeof(double));
+		}
+	}
+	delete [] key;
+
+	// Reallocate the blocks in the order of the curve, so that blocks
+	// that are visited consecutively also lie close together in memory
+	c_loop_hilbert_2d vl(*this);
+	int **nid=new int*[nxy];
+	double **np=new double*[nxy];
+	for(l=0;l<nxy;l++) {
+		ij=vl.block(l);
+		nid[ij]=new int[mem[ij]];
+		np[ij]=new double[ps*mem[ij]];
+		memcpy(nid[ij],id[ij],co[ij]*sizeof(int));
+		memcpy(np[ij],p[ij],ps*co[ij]*sizeof(double));
+	}
+	for(ij=0;ij<nxy;ij++) {
+		delete [] id[ij];id[ij]=nid[ij];
+		delete [] p[ij];p[ij]=np[ij];
+	}
+	delete [] nid;
+	delete [] np;
+}
+
+/** Inserts a packed array of binary particle records into the container. The
+ * records are scanned twice: the first pass finds the region of every
+ * particle and counts how many are added to each region, so that the memory
+ * for each region can be grown once, and the second pass copies the particles
+ * in.
+ * \param[in] rec a pointer to the first record.
+ * \param[in] n the number of records.
+ * \param[in] rsize the size of each record in bytes. This must be 28 for the
+ *                  container_poly_2d class, where the records carry radii.
+ * \param[in] vo an ordering class in which to record the regions, or NULL if
+ *               no ordering is required.
+ * \return The maximum radius read, or zero if the records carry no radii. */
+double container_base_2d::put_records(const char *rec,int n,int rsize,particle_order *vo) {
+	int l,ij,*bl=new int[n],*nco=new int[nxy];
+	double x,y,r,mr=0,*pp;
+	const char *rp;
+
+	// Compute the region of every particle, and the number of particles
+	// that each region will hold
+	for(l=0;l<nxy;l++) nco[l]=co[l];
+	for(rp=rec,l=0;l<n;l++,rp+=rsize) {
+		memcpy(&x,rp+4,8);memcpy(&y,rp+12,8);
+		if(put_remap(ij,x,y)) nco[ij]++;
+		else {
+#if VOROPP_REPORT_OUT_OF_BOUNDS ==1
+			fprintf(stderr,"Out of bounds: (x,y)=(%g,%g)\n",x,y);
+#endif
+			ij=-1;
+		}
+		bl[l]=ij;
+	}
+	for(l=0;l<nxy;l++) if(nco[l]>mem[l]) reserve_particle_memory(l,nco[l]);
+	delete [] nco;
+
+	// Copy the particles into their regions. For periodic containers, the
+	// positions are remapped into the primary domain again.
+	for(rp=rec,l=0;l<n;l++,rp+=rsize) {
+		if(bl[l]==-1) continue;
+		memcpy(&x,rp+4,8);memcpy(&y,rp+12,8);
+		if(xperiodic||yperiodic) put_remap(ij,x,y);
+		ij=bl[l];
+		memcpy(id[ij]+co[ij],rp,4);
+		if(vo!=NULL) vo->add(ij,co[ij]);
+		pp=p[ij]+ps*co[ij]++;
+		*(pp++)=x;*pp=y;
+		if(ps==3) {
+			memcpy(&r,rp+20,8);
+			pp[1]=r;
+			if(mr<r) mr=r;
+		}
+	}
+	delete [] bl;
+	return mr;
+}
+
+/** Imports a binary particle file into the container by mapping it into
+ * memory and passing the records to the bulk insertion routine. If the file
+ * cannot be successfully read, then the routine causes a fatal error.
+ * \param[in] filename the name of the file to read from.
+ * \param[in] vo an ordering class in which to record the regions, or NULL if
+ *               no ordering is required.
+ * \return The maximum radius read, or zero if the records carry no radii. */
+double container_base_2d::import_mapped(const char *filename,particle_order *vo) {
+	mapped_file_2d mf(filename);
+	binary_particle_header_2d h;
+	if(mf.size<sizeof(binary_particle_header_2d))
+		voro_fatal_error("Binary import error - can't read header",VOROPP_FILE_ERROR);
+	memcpy(&h,mf.data,sizeof(binary_particle_header_2d));
+	h.check();
+	if(ps==3&&!h.has_radius())
+		voro_fatal_error("Binary import error - file does not contain radii",VOROPP_FILE_ERROR);
+	if(h.n>(long long) ((mf.size-sizeof(binary_particle_header_2d))/h.rsize))
+		voro_fatal_error("Binary import error - file is truncated",VOROPP_FILE_ERROR);
+	if(h.n>INT_MAX||h.n>max_particle_memory_2d*(long long) nxy)
+		voro_fatal_error("Binary import error - too many particles",VOROPP_MEMORY_ERROR);
+	return put_records(mf.data+sizeof(binary_particle_header_2d),int(h.n),h.rsize,vo);
+}
+
+/** Imports a binary particle file into the container by reading it one chunk
+ * at a time from a stream, which avoids mapping the whole file into memory.
+ * \param[in] ps the stream to read from. */
+void container_2d::import_binary(particle_stream_2d &ps) {
+	while(ps.next_chunk()) put_records(ps.buf,ps.count,ps.h.rsize,NULL);
+	if(track) enable_tracking();
+}
+
+/** Imports a binary particle file with radii into the container by reading it
+ * one chunk at a time from a stream, which avoids mapping the whole file into
+ * memory. If the file does not carry radii, then the routine causes a fatal
+ * error.
+ * \param[in] ps the stream to read from. */
+void container_poly_2d::import_binary(particle_stream_2d &ps) {
+	if(!ps.h.has_radius())
+		voro_fatal_error("Binary import error - file does not contain radii",VOROPP_FILE_ERROR);
+	double r;
+	while(ps.next_chunk()) {
+		r=put_records(ps.buf,ps.count,ps.h.rsize,NULL);
+		if(max_radius<r) max_radius=r;
+	}
+}
+
 /** Import a list of particles from an open file stream into the container.
  * Entries of four numbers (Particle ID, x position, y position, z position)
  * are searched for. If the file cannot be successfully read, then the routine
@@ -365,6 +876,7 @@ void container_base_2d::region_count() {
 /** Clears a container of particles. */
 void container_2d::clear() {
 	for(int *cop=co;cop<co+nxy;cop++) *cop=0;
+	if(track) {tr.clear();dirty.clear();}
 }
 
 /** Clears a container of particles, also clearing resetting the maximum radius
@@ -433,26 +945,26 @@ void container_poly_2d::compute_all_cells() {
 
 /** Calculates all of the Voronoi cells and sums their volumes. In most cases
  * without walls, the sum of the Voronoi cell volumes should equal the volume
- * of the container to numerical precision.
+ * of the container to numerical precision. The cells are computed by a
+ * cell_metrics_2d class, so they are shared between threads if the code is
+ * compiled with OpenMP.
  * \return The sum of all of the computed Voronoi volumes. */
 double container_2d::sum_cell_areas() {
-	voronoicell_2d c;
-	double area=0;
-	c_loop_all_2d vl(*this);
-	if(vl.start()) do if(compute_cell(c,vl)) area+=c.area();while(vl.inc());
-	return area;
+	cell_metrics_2d m(false);
+	m.compute(*this);
+	return m.total_area;
 }
 
 /** Calculates all of the Voronoi cells and sums their volumes. In most cases
  * without walls, the sum of the Voronoi cell volumes should equal the volume
- * of the container to numerical precision.
+ * of the container to numerical precision. The cells are computed by a
+ * cell_metrics_2d class, so they are shared between threads if the code is
+ * compiled with OpenMP.
  * \return The sum of all of the computed Voronoi volumes. */
 double container_poly_2d::sum_cell_areas() {
-	voronoicell_2d c;
-	double area=0;
-	c_loop_all_2d vl(*this);
-	if(vl.start()) do if(compute_cell(c,vl)) area+=c.area();while(vl.inc());
-	return area;
+	cell_metrics_2d m(false);
+	m.compute(*this);
+	return m.total_area;
 }
 
 /** This function tests to see if a given vector lies within the container
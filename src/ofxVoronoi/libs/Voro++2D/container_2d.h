@@ -14,6 +14,7 @@
 #include <cstdlib>
 #include <cmath>
 #include <vector>
+#include <atomic>
 using namespace std;
 
 #include "config.h"
@@ -23,6 +24,9 @@ using namespace std;
 #include "c_loops_2d.h"
 #include "rad_option.h"
 #include "v_compute_2d.h"
+#include "binary_io_2d.h"
+#include "format_2d.h"
+#include "counters_2d.h"
 
 namespace voro {
 
@@ -160,6 +164,7 @@ class container_base_2d : public voro_base_2d, public wall_list_2d {
 		~container_base_2d();
 		bool point_inside(double x,double y);
 		void region_count();
+		void sort_hilbert();
 		inline bool skip(int ij,int l,double x,double y) {return false;}
 		template<class v_cell_2d>
 		inline bool boundary_cuts(v_cell_2d &c,int ij,double x,double y) {return true;}
@@ -264,11 +269,50 @@ class container_base_2d : public voro_base_2d, public wall_list_2d {
 		}
 	protected:
 		void add_particle_memory(int i);
+		void reserve_particle_memory(int i,int n);
+		double put_records(const char *rec,int n,int rsize,particle_order *vo);
+		double import_mapped(const char *filename,particle_order *vo);
 		inline bool put_locate_block(int &ij,double &x,double &y);
 		inline bool put_remap(int &ij,double &x,double &y);
 		inline bool remap(int &ai,int &aj,int &ci,int &cj,double &x,double &y,int &ij);
 };
 
+/** \brief A record of a particle, used for dynamic editing of a container.
+ *
+ * When dynamic editing is enabled, the container keeps one of these records
+ * for every particle ID, giving the location of the particle within the block
+ * structure and information about its most recently computed Voronoi cell. */
+struct particle_track_2d {
+	/** The block that the particle is within, or -1 if no particle
+	 * with this ID is in the container. */
+	int ij;
+	/** The index of the particle within its block. */
+	int q;
+	/** The squared maximum distance from the particle to a vertex of
+	 * its cell, in the doubled coordinates used by the cell class, or a
+	 * negative number if the cell has not been recorded. A particle
+	 * inserted closer than this can cut the cell. */
+	double reach;
+	/** The neighbor IDs of the recorded cell. */
+	vector<int> ne;
+	/** A counter used to avoid visiting a record twice in a search. */
+	int visit;
+	/** Whether the cell needs to be recomputed. */
+	bool dirty;
+	particle_track_2d() : ij(-1), q(0), reach(-1), visit(0), dirty(false) {}
+};
+
+/** \brief A particle that did not fit into its block during concurrent
+ * insertion, kept in a list until the insertion is finished. */
+struct concurrent_particle_2d {
+	/** The ID of the particle. */
+	int n;
+	/** The position of the particle. */
+	double x,y;
+	/** The next particle in the list. */
+	concurrent_particle_2d *next;
+};
+
 /** \brief Extension of the container_base class for computing regular Voronoi
  * tessellations.
  *
@@ -279,9 +323,13 @@ class container_2d : public container_base_2d, public radius_mono {
 	public:
 		container_2d(double ax_,double bx_,double ay_,double by_,
 			     int nx_,int ny_,bool xperiodic_,bool yperiodic_,int init_mem);
+		~container_2d();
 		void clear();
 		void put(int n,double x,double y);
 		void put(particle_order &vo,int n,double x,double y);
+		void begin_concurrent(int n,const double *sample=NULL,int ns=0);
+		void put_concurrent(int n,double x,double y);
+		void end_concurrent();
 		void import(FILE *fp=stdin);
 		void import(particle_order &vo,FILE *fp=stdin);
 		/** Imports a list of particles from an open file stream into
@@ -309,6 +357,36 @@ class container_2d : public container_base_2d, public radius_mono {
 			import(vo,fp);
 			fclose(fp);
 		}
+		void import_binary(particle_stream_2d &ps);
+		/** Imports a binary particle file into the container by
+		 * mapping it into memory and inserting all of the particles in
+		 * bulk. If the file cannot be successfully read, then the
+		 * routine causes a fatal error.
+		 * \param[in] filename the name of the file to read from. */
+		inline void import_binary(const char *filename) {
+			import_mapped(filename,NULL);
+			if(track) enable_tracking();
+		}
+		/** Imports a binary particle file into the container by
+		 * mapping it into memory and inserting all of the particles in
+		 * bulk. In addition, the order of the records in the file is
+		 * saved into an ordering class.
+		 * \param[in,out] vo the ordering class to use.
+		 * \param[in] filename the name of the file to read from. */
+		inline void import_binary(particle_order &vo,const char *filename) {
+			import_mapped(filename,&vo);
+			if(track) enable_tracking();
+		}
+		/** Inserts a packed array of binary particle records, in the
+		 * layout of a binary particle file without radii, into the
+		 * container in bulk. If dynamic editing is enabled, then the
+		 * tracking is rebuilt, as for import_binary().
+		 * \param[in] rec a pointer to the first record.
+		 * \param[in] n the number of records. */
+		inline void put_binary(const char *rec,int n) {
+			put_records(rec,n,20,NULL);
+			if(track) enable_tracking();
+		}
 		void compute_all_cells();
 		double sum_cell_areas();
 		/** Dumps particle IDs and positions to a file.
@@ -335,6 +413,33 @@ class container_2d : public container_base_2d, public radius_mono {
 			draw_particles(fp);
 			fclose(fp);
 		}
+		/** Dumps particle IDs and positions to a binary particle file.
+		 * The file stream must be seekable, since the header is
+		 * rewritten with the particle count once it is known.
+		 * \param[in] vl the loop class to use.
+		 * \param[in] fp a file handle to write to. */
+		template<class c_loop_2d>
+		void draw_particles_binary(c_loop_2d &vl,FILE *fp) {
+			binary_particle_header_2d h;double *pp;
+			h.init(false);
+			long hp=ftell(fp);
+			write_binary_particle_header(h,fp);
+			if(vl.start()) do {
+				pp=p[vl.ij]+2*vl.q;
+				write_binary_particle(id[vl.ij][vl.q],*pp,pp[1],fp);
+				h.n++;
+			} while(vl.inc());
+			rewrite_binary_particle_header(h,hp,fp);
+		}
+		/** Dumps all of the particle IDs and positions to a binary
+		 * particle file.
+		 * \param[in] filename the name of the file to write to. */
+		inline void draw_particles_binary(const char *filename) {
+			FILE *fp=safe_fopen(filename,"wb");
+			c_loop_all_2d vl(*this);
+			draw_particles_binary(vl,fp);
+			fclose(fp);
+		}
 		/** Dumps particle positions in POV-Ray format.
 		 * \param[in] vl the loop class to use.
 		 * \param[in] fp a file handle to write to. */
@@ -415,6 +520,46 @@ class container_2d : public container_base_2d, public radius_mono {
 			draw_cells_pov(fp);
 			fclose(fp);
 		}
+		/** Computes Voronoi cells and saves them in the binary
+		 * tessellation format, in a single pass through a buffered
+		 * stream.
+		 * \param[in] vl the loop class to use.
+		 * \param[in] fp a file handle to write to, which must be
+		 *               seekable.
+		 * \param[in] flags a combination of
+		 *                  binary_tessellation_neighbors and
+		 *                  binary_tessellation_delta, to select
+		 *                  whether neighbor IDs are included and
+		 *                  whether the vertices are stored as
+		 *                  single-precision offsets. */
+		template<class c_loop_2d>
+		void draw_cells_binary(c_loop_2d &vl,FILE *fp,unsigned int flags) {
+			tessellation_writer_2d tw(fp,flags);double *pp;
+			if(tw.neighbor()) {
+				voronoicell_neighbor_2d c;
+				if(vl.start()) do if(compute_cell(c,vl)) {
+					pp=p[vl.ij]+ps*vl.q;
+					tw.add(c,id[vl.ij][vl.q],*pp,pp[1]);
+				} while(vl.inc());
+			} else {
+				voronoicell_2d c;
+				if(vl.start()) do if(compute_cell(c,vl)) {
+					pp=p[vl.ij]+ps*vl.q;
+					tw.add(c,id[vl.ij][vl.q],*pp,pp[1]);
+				} while(vl.inc());
+			}
+			tw.finish();
+		}
+		/** Computes all Voronoi cells and saves them in the binary
+		 * tessellation format.
+		 * \param[in] filename the name of the file to write to.
+		 * \param[in] flags the flags selecting the record layout. */
+		inline void draw_cells_binary(const char *filename,unsigned int flags=0) {
+			FILE *fp=safe_fopen(filename,"wb");
+			c_loop_all_2d vl(*this);
+			draw_cells_binary(vl,fp,flags);
+			fclose(fp);
+		}
 		/** Computes the Voronoi cells and saves customized information
 		 * about them.
 		 * \param[in] vl the loop class to use.
@@ -423,23 +568,37 @@ class container_2d : public container_base_2d, public radius_mono {
 		template<class c_loop_2d>
 		void print_custom(c_loop_2d &vl,const char *format,FILE *fp) {
 			int ij,q;double *pp;
-			if(contains_neighbor(format)) {
+			custom_format_2d cf(format);
+			output_buffer_2d ob(fp);
+			if(cf.neighbor) {
 				voronoicell_neighbor_2d c;
 				if(vl.start()) do if(compute_cell(c,vl)) {
 					ij=vl.ij;q=vl.q;pp=p[ij]+ps*q;
-					c.output_custom(format,id[ij][q],*pp,pp[1],default_radius_2d,fp);
+					cf.output(c,id[ij][q],*pp,pp[1],default_radius_2d,ob);
 				} while(vl.inc());
 			} else {
 				voronoicell_2d c;
 				if(vl.start()) do if(compute_cell(c,vl)) {
 					ij=vl.ij;q=vl.q;pp=p[ij]+ps*q;
-					c.output_custom(format,id[ij][q],*pp,pp[1],default_radius_2d,fp);
+					cf.output(c,id[ij][q],*pp,pp[1],default_radius_2d,ob);
 				} while(vl.inc());
 			}
 		}
 		void print_custom(const char *format,FILE *fp=stdout);
 		void print_custom(const char *format,const char *filename);
 		bool find_voronoi_cell(double x,double y,double &rx,double &ry,int &pid);
+		void enable_tracking();
+		/** Returns whether dynamic editing is enabled. */
+		inline bool tracking() {return track;}
+		bool find_particle(int n,int &ij,int &q);
+		bool remove(int n);
+		bool move(int n,double x,double y);
+		void sort_hilbert();
+		void record_cell(int n,voronoicell_neighbor_2d &c);
+		void take_dirty(particle_order &vo);
+		/** Returns the number of entries in the list of particles
+		 * whose cells need to be recomputed. */
+		inline int dirty_count() {return int(dirty.size());}
 		/** Computes the Voronoi cell for a particle currently being
 		 * referenced by a loop class.
 		 * \param[out] c a Voronoi cell class in which to store the
@@ -450,7 +609,7 @@ class container_2d : public container_base_2d, public radius_mono {
 		 * condition, then the routine returns false. */
 		template<class v_cell_2d,class c_loop_2d>
 		inline bool compute_cell(v_cell_2d &c,c_loop_2d &vl) {
-			return vc.compute_cell(c,vl.ij,vl.q,vl.i,vl.j);
+			return count_deleted_cell_2d(vc.compute_cell(c,vl.ij,vl.q,vl.i,vl.j));
 		}
 		/** Computes the Voronoi cell for given particle.
 		 * \param[out] c a Voronoi cell class in which to store the
@@ -463,10 +622,43 @@ class container_2d : public container_base_2d, public radius_mono {
 		template<class v_cell_2d>
 		inline bool compute_cell(v_cell_2d &c,int ij,int q) {
 			int j=ij/nx,i=ij-j*nx;
-			return vc.compute_cell(c,ij,q,i,j);
+			return count_deleted_cell_2d(vc.compute_cell(c,ij,q,i,j));
 		}
 	private:
 		voro_compute_2d<container_2d> vc;
+		/** Whether dynamic editing is enabled. */
+		bool track;
+		/** The counter used to mark records visited in a search. */
+		int tvisit;
+		/** The records of each particle ID, used when dynamic editing
+		 * is enabled. */
+		vector<particle_track_2d> tr;
+		/** The IDs of the particles whose cells need to be
+		 * recomputed. */
+		vector<int> dirty;
+		/** A stack used when searching for the cells affected by a
+		 * new particle. */
+		vector<int> tstack;
+		/** A cell used to refresh out of date records. */
+		voronoicell_neighbor_2d tcell;
+		/** The number of slots claimed in each block during concurrent
+		 * insertion, or NULL if concurrent insertion is not in
+		 * progress. */
+		atomic<int> *cco;
+		/** The list of particles that did not fit into their blocks
+		 * during concurrent insertion. */
+		atomic<concurrent_particle_2d*> ovf;
+		/** Marks a particle's cell as needing to be recomputed.
+		 * \param[in] n the ID of the particle. */
+		inline void mark_dirty(int n) {
+			if(!tr[n].dirty) {tr[n].dirty=true;dirty.push_back(n);}
+		}
+		void track_put(int n,double x,double y,int ij);
+		void refresh_record(particle_track_2d &t);
+		void mark_neighbors(particle_track_2d &t);
+		void mark_coincident(particle_track_2d &t);
+		void mark_insertion(double x,double y);
+		void take_particle(int ij,int q);
 		friend class voro_compute_2d<container_2d>;
 };
 
@@ -511,6 +703,27 @@ class container_poly_2d : public container_base_2d, public radius_poly {
 			import(vo,fp);
 			fclose(fp);
 		}
+		void import_binary(particle_stream_2d &ps);
+		/** Imports a binary particle file with radii into the
+		 * container_poly class by mapping it into memory and inserting
+		 * all of the particles in bulk. If the file cannot be
+		 * successfully read, or carries no radii, then the routine
+		 * causes a fatal error.
+		 * \param[in] filename the name of the file to read from. */
+		inline void import_binary(const char *filename) {
+			double r=import_mapped(filename,NULL);
+			if(max_radius<r) max_radius=r;
+		}
+		/** Imports a binary particle file with radii into the
+		 * container_poly class by mapping it into memory and inserting
+		 * all of the particles in bulk. In addition, the order of the
+		 * records in the file is saved into an ordering class.
+		 * \param[in,out] vo the ordering class to use.
+		 * \param[in] filename the name of the file to read from. */
+		inline void import_binary(particle_order &vo,const char *filename) {
+			double r=import_mapped(filename,&vo);
+			if(max_radius<r) max_radius=r;
+		}
 		void compute_all_cells();
 		double sum_cell_areas();
 		/** Dumps particle IDs, positions and radii to a file.
@@ -539,6 +752,34 @@ class container_poly_2d : public container_base_2d, public radius_poly {
 			draw_particles(fp);
 			fclose(fp);
 		}
+		/** Dumps particle IDs, positions and radii to a binary
+		 * particle file. The file stream must be seekable, since the
+		 * header is rewritten with the particle count once it is
+		 * known.
+		 * \param[in] vl the loop class to use.
+		 * \param[in] fp a file handle to write to. */
+		template<class c_loop_2d>
+		void draw_particles_binary(c_loop_2d &vl,FILE *fp) {
+			binary_particle_header_2d h;double *pp;
+			h.init(true);
+			long hp=ftell(fp);
+			write_binary_particle_header(h,fp);
+			if(vl.start()) do {
+				pp=p[vl.ij]+3*vl.q;
+				write_binary_particle(id[vl.ij][vl.q],*pp,pp[1],pp[2],fp);
+				h.n++;
+			} while(vl.inc());
+			rewrite_binary_particle_header(h,hp,fp);
+		}
+		/** Dumps all of the particle IDs, positions and radii to a binary
+		 * particle file.
+		 * \param[in] filename the name of the file to write to. */
+		inline void draw_particles_binary(const char *filename) {
+			FILE *fp=safe_fopen(filename,"wb");
+			c_loop_all_2d vl(*this);
+			draw_particles_binary(vl,fp);
+			fclose(fp);
+		}
 		/** Dumps particle positions in POV-Ray format.
 		 * \param[in] vl the loop class to use.
 		 * \param[in] fp a file handle to write to. */
@@ -619,6 +860,46 @@ class container_poly_2d : public container_base_2d, public radius_poly {
 			draw_cells_pov(fp);
 			fclose(fp);
 		}
+		/** Computes Voronoi cells and saves them in the binary
+		 * tessellation format, in a single pass through a buffered
+		 * stream.
+		 * \param[in] vl the loop class to use.
+		 * \param[in] fp a file handle to write to, which must be
+		 *               seekable.
+		 * \param[in] flags a combination of
+		 *                  binary_tessellation_neighbors and
+		 *                  binary_tessellation_delta, to select
+		 *                  whether neighbor IDs are included and
+		 *                  whether the vertices are stored as
+		 *                  single-precision offsets. */
+		template<class c_loop_2d>
+		void draw_cells_binary(c_loop_2d &vl,FILE *fp,unsigned int flags) {
+			tessellation_writer_2d tw(fp,flags);double *pp;
+			if(tw.neighbor()) {
+				voronoicell_neighbor_2d c;
+				if(vl.start()) do if(compute_cell(c,vl)) {
+					pp=p[vl.ij]+ps*vl.q;
+					tw.add(c,id[vl.ij][vl.q],*pp,pp[1]);
+				} while(vl.inc());
+			} else {
+				voronoicell_2d c;
+				if(vl.start()) do if(compute_cell(c,vl)) {
+					pp=p[vl.ij]+ps*vl.q;
+					tw.add(c,id[vl.ij][vl.q],*pp,pp[1]);
+				} while(vl.inc());
+			}
+			tw.finish();
+		}
+		/** Computes all Voronoi cells and saves them in the binary
+		 * tessellation format.
+		 * \param[in] filename the name of the file to write to.
+		 * \param[in] flags the flags selecting the record layout. */
+		inline void draw_cells_binary(const char *filename,unsigned int flags=0) {
+			FILE *fp=safe_fopen(filename,"wb");
+			c_loop_all_2d vl(*this);
+			draw_cells_binary(vl,fp,flags);
+			fclose(fp);
+		}
 		/** Computes the Voronoi cells and saves customized information
 		 * about them.
 		 * \param[in] vl the loop class to use.
@@ -627,17 +908,19 @@ class container_poly_2d : public container_base_2d, public radius_poly {
 		template<class c_loop_2d>
 		void print_custom(c_loop_2d &vl,const char *format,FILE *fp) {
 			int ij,q;double *pp;
-			if(contains_neighbor(format)) {
+			custom_format_2d cf(format);
+			output_buffer_2d ob(fp);
+			if(cf.neighbor) {
 				voronoicell_neighbor_2d c;
 				if(vl.start()) do if(compute_cell(c,vl)) {
 					ij=vl.ij;q=vl.q;pp=p[ij]+ps*q;
-					c.output_custom(format,id[ij][q],*pp,pp[1],pp[2],fp);
+					cf.output(c,id[ij][q],*pp,pp[1],pp[2],ob);
 				} while(vl.inc());
 			} else {
 				voronoicell_2d c;
 				if(vl.start()) do if(compute_cell(c,vl)) {
 					ij=vl.ij;q=vl.q;pp=p[ij]+ps*q;
-					c.output_custom(format,id[ij][q],*pp,pp[1],pp[2],fp);
+					cf.output(c,id[ij][q],*pp,pp[1],pp[2],ob);
 				} while(vl.inc());
 			}
 		}
@@ -651,7 +934,7 @@ class container_poly_2d : public container_base_2d, public radius_poly {
 		 * condition, then the routine returns false. */
 		template<class v_cell_2d,class c_loop_2d>
 		inline bool compute_cell(v_cell_2d &c,c_loop_2d &vl) {
-			return vc.compute_cell(c,vl.ij,vl.q,vl.i,vl.j);
+			return count_deleted_cell_2d(vc.compute_cell(c,vl.ij,vl.q,vl.i,vl.j));
 		}
 		/** Computes the Voronoi cell for given particle.
 		 * \param[out] c a Voronoi cell class in which to store the
@@ -664,7 +947,7 @@ class container_poly_2d : public container_base_2d, public radius_poly {
 		template<class v_cell_2d>
 		inline bool compute_cell(v_cell_2d &c,int ij,int q) {
 			int j=ij/nx,i=ij-j*nx;
-			return vc.compute_cell(c,ij,q,i,j);
+			return count_deleted_cell_2d(vc.compute_cell(c,ij,q,i,j));
 		}
 		void print_custom(const char *format,FILE *fp=stdout);
 		void print_custom(const char *format,const char *filename);
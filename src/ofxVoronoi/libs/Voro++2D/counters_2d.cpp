@@ -0,0 +1,105 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file counters_2d.cpp
+ * \brief Function implementations for the optional instrumentation
+ * counters. */
+
+#include "counters_2d.h"
+
+#if VOROPP_COUNTERS
+#include <mutex>
+#include <vector>
+#include <algorithm>
+using namespace std;
+#endif
+
+namespace voro {
+
+/** Sets all of the counts to zero. */
+void voro_counters_2d::reset() {
+	nplane=nplane_cut=worklist_blocks=search_blocks=0;
+	vertex_growth=delete_growth=particle_growth=deleted_cells=0;
+}
+
+/** Adds another set of counts to this one.
+ * \param[in] c the counts to add. */
+void voro_counters_2d::add(const voro_counters_2d &c) {
+	nplane+=c.nplane;
+	nplane_cut+=c.nplane_cut;
+	worklist_blocks+=c.worklist_blocks;
+	search_blocks+=c.search_blocks;
+	vertex_growth+=c.vertex_growth;
+	delete_growth+=c.delete_growth;
+	particle_growth+=c.particle_growth;
+	deleted_cells+=c.deleted_cells;
+}
+
+#if VOROPP_COUNTERS
+
+thread_local voro_thread_counters_2d thread_counters_2d;
+
+/** The lock protecting the list of registered counters. */
+static mutex counters_lock;
+/** The counters of the threads that have used them and are still running. */
+static vector<voro_thread_counters_2d*> counters_list;
+/** The summed counts of the threads that have exited. */
+static voro_counters_2d counters_retired;
+
+/** \brief Adds the counters of a thread to the list, and folds them into the
+ * retired counts when the thread exits. */
+class counters_registration_2d {
+	public:
+		counters_registration_2d() {
+			lock_guard<mutex> l(counters_lock);
+			counters_list.push_back(&thread_counters_2d);
+		}
+		~counters_registration_2d() {
+			lock_guard<mutex> l(counters_lock);
+			counters_retired.add(thread_counters_2d);
+			counters_list.erase(find(counters_list.begin(),counters_list.end(),&thread_counters_2d));
+			thread_counters_2d.registered=false;
+		}
+};
+
+/** Registers the counters of the current thread.
+ * \return True. */
+bool register_thread_counters_2d() {
+	static thread_local counters_registration_2d r;
+	return thread_counters_2d.registered=true;
+}
+
+/** Sums the counts of all threads. The counts of threads that are still
+ * computing may be read part way through an update.
+ * \param[out] c the summed counts. */
+void collect_counters_2d(voro_counters_2d &c) {
+	lock_guard<mutex> l(counters_lock);
+	c=counters_retired;
+	for(unsigned int i=0;i<counters_list.size();i++) c.add(*counters_list[i]);
+}
+
+/** Sets the counts of all threads to zero. This should only be called while
+ * no other thread is computing. */
+void reset_counters_2d() {
+	lock_guard<mutex> l(counters_lock);
+	counters_retired.reset();
+	for(unsigned int i=0;i<counters_list.size();i++) counters_list[i]->reset();
+}
+
+#else
+
+/** Returns zero counts, since the library was compiled without counters.
+ * \param[out] c the counts. */
+void collect_counters_2d(voro_counters_2d &c) {
+	c.reset();
+}
+
+/** Does nothing, since the library was compiled without counters. */
+void reset_counters_2d() {}
+
+#endif
+
+}
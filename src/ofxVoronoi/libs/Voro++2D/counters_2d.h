@@ -0,0 +1,77 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file counters_2d.h
+ * \brief Header file for the optional instrumentation counters. */
+
+#ifndef VOROPP_COUNTERS_2D_HH
+#define VOROPP_COUNTERS_2D_HH
+
+#include "config.h"
+
+namespace voro {
+
+/** \brief A set of counts of the internal operations of the library.
+ *
+ * When the library is compiled with VOROPP_COUNTERS set to 1, every thread
+ * keeps its own copy of these counts, which are incremented without any
+ * locking. The counts of all threads can be summed with
+ * collect_counters_2d(). */
+struct voro_counters_2d {
+	/** The number of plane cuts that were tested against a cell. */
+	unsigned long long nplane;
+	/** The number of plane cuts that actually cut a cell. */
+	unsigned long long nplane_cut;
+	/** The number of blocks scanned from the precomputed worklist. */
+	unsigned long long worklist_blocks;
+	/** The number of blocks scanned by the fallback search, which uses
+	 * the mask and the queue once the worklist is exhausted. */
+	unsigned long long search_blocks;
+	/** The number of times the vertex memory of a cell was grown. */
+	unsigned long long vertex_growth;
+	/** The number of times the delete stack of a cell was grown. */
+	unsigned long long delete_growth;
+	/** The number of times the particle memory of a block was grown. */
+	unsigned long long particle_growth;
+	/** The number of cells that were removed entirely, by plane cuts or
+	 * walls. */
+	unsigned long long deleted_cells;
+	void reset();
+	void add(const voro_counters_2d &c);
+};
+
+void collect_counters_2d(voro_counters_2d &c);
+void reset_counters_2d();
+
+#if VOROPP_COUNTERS
+/** \brief The counts of a single thread. */
+struct voro_thread_counters_2d : public voro_counters_2d {
+	/** Whether the counts have been added to the list that
+	 * collect_counters_2d() sums over. */
+	bool registered;
+};
+
+extern thread_local voro_thread_counters_2d thread_counters_2d;
+bool register_thread_counters_2d();
+
+/** Increments a counter of the current thread, registering the counters of
+ * the thread on first use. */
+#define VOROPP_COUNT(field) ((void) (voro::thread_counters_2d.registered||voro::register_thread_counters_2d()),voro::thread_counters_2d.field++)
+#else
+#define VOROPP_COUNT(field) ((void) 0)
+#endif
+
+/** Counts a cell computation that removed the cell entirely.
+ * \param[in] computed the value returned by the computation.
+ * \return The same value. */
+inline bool count_deleted_cell_2d(bool computed) {
+	if(!computed) VOROPP_COUNT(deleted_cells);
+	return computed;
+}
+
+}
+
+#endif
@@ -9,6 +9,7 @@
  * \brief Function implementations for the ctr_boundary_2d and related classes. */
 
 #include "ctr_boundary_2d.h"
+#include "counters_2d.h"
 #include <string.h>
 
 namespace voro {
@@ -157,6 +158,7 @@ inline bool container_boundary_2d::put_remap(int &ij,double &x,double &y) {
  * \param[in] i the index of the region to reallocate. */
 void container_boundary_2d::add_particle_memory(int i) {
 	int l,nmem=mem[i]<<1;
+	VOROPP_COUNT(particle_growth);
 
 	// Carry out a check on the memory allocation size, and
 	// print a status message if requested
@@ -24,6 +24,8 @@ using namespace std;
 #include "c_loops_2d.h"
 #include "rad_option.h"
 #include "v_compute_2d.h"
+#include "format_2d.h"
+#include "counters_2d.h"
 
 namespace voro {
 
@@ -352,12 +354,14 @@ class container_boundary_2d : public voro_base_2d, public radius_mono {
 		template<class c_loop_2d>
 		void print_custom(c_loop_2d &vl,const char *format,FILE *fp) {
 			int ij,q;double *pp;
+			custom_format_2d cf(format);
+			output_buffer_2d ob(fp);
 		//	bool glob=false, loc=false;	
 		//	if(contains_neighbor_global(format)){
 		//		init_globne();	
 		//		glob=true;
 		//	}
-			if(contains_neighbor(format)){
+			if(cf.neighbor){
 		//		loc=true;
 		//	}
 		//	if(glob || loc) {
@@ -366,14 +370,14 @@ class container_boundary_2d : public voro_base_2d, public radius_mono {
 			
 					ij=vl.ij;q=vl.q;pp=p[ij]+ps*q;
 			//		if(glob) add_globne_info(id[ij][q], c.ne, c.p);
-					c.output_custom(format,id[ij][q],*pp,pp[1],default_radius_2d,fp);
+					cf.output(c,id[ij][q],*pp,pp[1],default_radius_2d,ob);
 				} while(vl.inc());
 			//	if(glob) print_globne(fp);
 			} else {
 				voronoicell_nonconvex_2d c;
 				if(vl.start()) do if(compute_cell(c,vl)) {
 					ij=vl.ij;q=vl.q;pp=p[ij]+ps*q;
-					c.output_custom(format,id[ij][q],*pp,pp[1],default_radius_2d,fp);
+					cf.output(c,id[ij][q],*pp,pp[1],default_radius_2d,ob);
 				} while(vl.inc());
 			}
 		}
@@ -390,7 +394,7 @@ class container_boundary_2d : public voro_base_2d, public radius_mono {
 		 * condition, then the routine returns false. */
 		template<class v_cell_2d,class c_loop_2d>
 		inline bool compute_cell(v_cell_2d &c,c_loop_2d &vl) {
-			return vc.compute_cell(c,vl.ij,vl.q,vl.i,vl.j);
+			return count_deleted_cell_2d(vc.compute_cell(c,vl.ij,vl.q,vl.i,vl.j));
 		}
 		/** Computes the Voronoi cell for given particle.
 		 * \param[out] c a Voronoi cell class in which to store the
@@ -403,7 +407,7 @@ class container_boundary_2d : public voro_base_2d, public radius_mono {
 		template<class v_cell_2d>
 		inline bool compute_cell(v_cell_2d &c,int ij,int q) {
 			int j=ij/nx,i=ij-j*nx;
-			return vc.compute_cell(c,ij,q,i,j);
+			return count_deleted_cell_2d(vc.compute_cell(c,ij,q,i,j));
 		}
 		void setup();
 		bool skip(int ij,int l,double x,double y);
@@ -0,0 +1,237 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file format_2d.cpp
+ * \brief Function implementations for the precompiled custom output format
+ * and the buffered output stream. */
+
+#include "format_2d.h"
+
+namespace voro {
+
+/** Powers of ten used to scale numbers to six significant digits. */
+static const double fmt_pow10[]={1,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10};
+
+/** The class constructor allocates the buffer.
+ * \param[in] fp_ the file handle to write to.
+ * \param[in] size_ the size of the buffer in bytes. */
+output_buffer_2d::output_buffer_2d(FILE *fp_,int size_)
+	: fp(fp_), buf(new char[size_<64?64:size_]), bp(buf), be(buf+(size_<64?64:size_)) {}
+
+/** The class destructor writes out any remaining output and frees the
+ * buffer. */
+output_buffer_2d::~output_buffer_2d() {
+	flush();
+	delete [] buf;
+}
+
+/** Hands the contents of the buffer to the file stream. */
+void output_buffer_2d::flush() {
+	if(bp>buf) {
+		if(fwrite(buf,1,bp-buf,fp)!=size_t(bp-buf))
+			voro_fatal_error("Unable to write custom output",VOROPP_FILE_ERROR);
+		bp=buf;
+	}
+}
+
+/** Appends an integer to the buffer in decimal.
+ * \param[in] i the integer to append. */
+void output_buffer_2d::put_int(int i) {
+	char t[12],*tp=t+12;
+	unsigned int u=i<0?0u-(unsigned int) i:(unsigned int) i;
+	do {*(--tp)='0'+u%10;u/=10;} while(u>0);
+	if(i<0) *(--tp)='-';
+	put(tp,int(t+12-tp));
+}
+
+/** Appends a floating point number to the buffer, formatted in the same way
+ * as the "%g" printf conversion. Numbers whose magnitude lies between 1e-4 and
+ * 1e6 are handled with integer arithmetic. Numbers outside this range, and the
+ * rare cases where the sixth significant digit lies too close to a rounding
+ * boundary to be decided reliably, are passed to the C library.
+ * \param[in] d the number to append. */
+void output_buffer_2d::put_double(double d) {
+	if(be-bp<32) flush();
+	if(d==0) {
+		if(1/d<0) *(bp++)='-';
+		*(bp++)='0';
+		return;
+	}
+	double a=d<0?-d:d,s,f;
+	if(a>=1e-4&&a<1e6) {
+		int e=int(floor(log10(a))),m,k,l;
+		if(e<-4) e=-4;
+		if(e>5) e=5;
+
+		// Scale the number so that it has six digits before the
+		// decimal point, correcting the exponent if log10 was inexact
+		s=a*fmt_pow10[5-e];
+		if(s<1e5&&e>-4) {e--;s=a*fmt_pow10[5-e];}
+		m=int(s);f=s-m;
+		if(f>0.5-1e-7&&f<0.5+1e-7) {
+			bp+=sprintf(bp,"%g",d);
+			return;
+		}
+		if(f>0.5) m++;
+		if(m>=1000000) {
+			m/=10;e++;
+			if(e>5) {bp+=sprintf(bp,"%g",d);return;}
+		}
+
+		// Extract the six digits and strip the trailing zeros
+		char dig[6];
+		for(k=5;k>=0;k--) {dig[k]='0'+m%10;m/=10;}
+		l=6;
+		while(l>e+1&&l>1&&dig[l-1]=='0') l--;
+
+		// Assemble the number
+		if(d<0) *(bp++)='-';
+		if(e>=0) {
+			for(k=0;k<=e;k++) *(bp++)=dig[k];
+			if(l>e+1) {
+				*(bp++)='.';
+				for(;k<l;k++) *(bp++)=dig[k];
+			}
+		} else {
+			*(bp++)='0';*(bp++)='.';
+			for(k=-1;k>e;k--) *(bp++)='0';
+			for(k=0;k<l;k++) *(bp++)=dig[k];
+		}
+		return;
+	}
+	bp+=sprintf(bp,"%g",d);
+}
+
+/** The class constructor parses a custom output format string into a list of
+ * operations. The control sequences are the same as those accepted by the
+ * voronoicell_base_2d::output_custom() routine. A newline is appended to the
+ * end of the format.
+ * \param[in] format the custom output string to compile. */
+custom_format_2d::custom_format_2d(const char *format) : neighbor(false) {
+	const char *fmp=format;
+	int op;
+	while(*fmp!=0) {
+		if(*fmp=='%') {
+			fmp++;
+			switch(*fmp) {
+
+				// Particle-related output
+				case 'i': op=op_id;break;
+				case 'x': op=op_x;break;
+				case 'y': op=op_y;break;
+				case 'q': op=op_pos;break;
+				case 'r': op=op_rad;break;
+
+				// Vertex-related output
+				case 'w': op=op_nvert;break;
+				case 'p': op=op_verts;break;
+				case 'P': op=op_verts_global;break;
+				case 'm': op=op_maxrad;break;
+
+				// Edge-related output
+				case 'g': op=op_nvert;break;
+				case 'E': op=op_perim;break;
+				case 'e': op=op_edges;break;
+				case 'l': op=op_normals;break;
+				case 'n': op=op_neigh;neighbor=true;break;
+
+				// Area-related output
+				case 'a': op=op_area;break;
+				case 'c': op=op_centroid;break;
+				case 'C': op=op_centroid_global;break;
+
+				// End-of-string reached
+				case 0: fmp--;op=-1;break;
+
+				// The percent sign is not part of a
+				// control sequence
+				default: add_literal('%');add_literal(*fmp);op=-1;
+			}
+			if(op!=-1) {ops.push_back(op);ops.push_back(0);ops.push_back(0);}
+		} else add_literal(*fmp);
+		fmp++;
+	}
+	add_literal('\n');
+}
+
+/** Adds a character to the format, extending the previous literal operation
+ * if there is one.
+ * \param[in] ch the character to add. */
+void custom_format_2d::add_literal(char ch) {
+	int s=ops.size();
+	if(s>0&&ops[s-3]==op_literal) ops[s-1]++;
+	else {ops.push_back(op_literal);ops.push_back(lit.size());ops.push_back(1);}
+	lit.push_back(ch);
+}
+
+/** Outputs a line of custom information about a Voronoi cell.
+ * \param[in] c a reference to the Voronoi cell.
+ * \param[in] i the ID of the particle associated with this Voronoi cell.
+ * \param[in] (x,y) the position of the particle associated with this Voronoi
+ *                  cell.
+ * \param[in] r a radius associated with the particle.
+ * \param[in] ob the output buffer to write to. */
+void custom_format_2d::output(voronoicell_base_2d &c,int i,double x,double y,double r,output_buffer_2d &ob) {
+	double cx,cy,*ptsp,*ptse=c.pts+2*c.p;
+	unsigned int k,l;
+	for(k=0;k<ops.size();k+=3) switch(ops[k]) {
+		case op_literal: ob.put(&lit[ops[k+1]],ops[k+2]);break;
+		case op_id: ob.put_int(i);break;
+		case op_x: ob.put_double(x);break;
+		case op_y: ob.put_double(y);break;
+		case op_pos: ob.put_double(x);ob.put(' ');ob.put_double(y);break;
+		case op_rad: ob.put_double(r);break;
+		case op_nvert: ob.put_int(c.p);break;
+		case op_verts:
+			for(ptsp=c.pts;ptsp<ptse;ptsp+=2) {
+				if(ptsp>c.pts) ob.put(' ');
+				ob.put('(');ob.put_double(*ptsp*0.5);
+				ob.put(',');ob.put_double(ptsp[1]*0.5);ob.put(')');
+			}
+			break;
+		case op_verts_global:
+			for(ptsp=c.pts;ptsp<ptse;ptsp+=2) {
+				if(ptsp>c.pts) ob.put(' ');
+				ob.put('(');ob.put_double(x+*ptsp*0.5);
+				ob.put(',');ob.put_double(y+ptsp[1]*0.5);ob.put(')');
+			}
+			break;
+		case op_maxrad: ob.put_double(0.25*c.max_radius_squared());break;
+		case op_perim: ob.put_double(c.perimeter());break;
+		case op_edges:
+			c.edge_lengths(vd);
+			for(l=0;l<vd.size();l++) {
+				if(l>0) ob.put(' ');
+				ob.put_double(vd[l]);
+			}
+			break;
+		case op_normals:
+			c.normals(vd);
+			for(l=0;l<vd.size();l+=2) {
+				if(l>0) ob.put(' ');
+				ob.put('(');ob.put_double(vd[l]);
+				ob.put(',');ob.put_double(vd[l+1]);ob.put(')');
+			}
+			break;
+		case op_neigh:
+			c.neighbors(vi);
+			for(l=0;l<vi.size();l++) {
+				if(l>0) ob.put(' ');
+				ob.put_int(vi[l]);
+			}
+			break;
+		case op_area: ob.put_double(c.area());break;
+		case op_centroid:
+			c.centroid(cx,cy);
+			ob.put_double(cx);ob.put(' ');ob.put_double(cy);
+			break;
+		case op_centroid_global:
+			c.centroid(cx,cy);
+			ob.put_double(x+cx);ob.put(' ');ob.put_double(y+cy);
+	}
+}
+
+}
@@ -0,0 +1,106 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file format_2d.h
+ * \brief Header file for the precompiled custom output format and the
+ * buffered output stream that it writes to. */
+
+#ifndef VOROPP_FORMAT_2D_HH
+#define VOROPP_FORMAT_2D_HH
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#include "config.h"
+#include "common.h"
+#include "cell_2d.h"
+
+namespace voro {
+
+/** \brief A buffered output stream with fast number formatting.
+ *
+ * Writing cell statistics with one fprintf call per field spends most of its
+ * time parsing printf format strings and locking the stream. This class
+ * collects the output in a large user-space buffer and only hands it to the
+ * C standard I/O library when the buffer is full. Floating point numbers are
+ * formatted identically to the "%g" printf conversion, using an integer fast
+ * path for the common case. */
+class output_buffer_2d {
+	public:
+		output_buffer_2d(FILE *fp_,int size_=init_output_buffer_size);
+		~output_buffer_2d();
+		void flush();
+		/** Appends a single character to the buffer.
+		 * \param[in] ch the character to append. */
+		inline void put(char ch) {
+			if(bp==be) flush();
+			*(bp++)=ch;
+		}
+		/** Appends a string of characters to the buffer.
+		 * \param[in] s a pointer to the characters.
+		 * \param[in] n the number of characters to append. */
+		inline void put(const char *s,int n) {
+			if(bp+n>be) {
+				flush();
+				if(n>be-buf) {fwrite(s,1,n,fp);return;}
+			}
+			memcpy(bp,s,n);bp+=n;
+		}
+		void put_int(int i);
+		void put_double(double d);
+	private:
+		/** The file handle to write to. */
+		FILE *fp;
+		/** The start of the buffer. */
+		char *buf;
+		/** The current position in the buffer. */
+		char *bp;
+		/** The end of the buffer. */
+		char *be;
+};
+
+/** \brief A custom output format, compiled into a list of operations.
+ *
+ * The custom output routines take a format string with control sequences
+ * similar to the standard C printf() routine, such as "%i %q %a". This class
+ * parses the string once into a list of operations, so that the string does
+ * not need to be parsed again for every cell that is output. */
+class custom_format_2d {
+	public:
+		/** Whether the format requires neighbor information, which is
+		 * the case if the "%n" control sequence appears. */
+		bool neighbor;
+		custom_format_2d(const char *format);
+		void output(voronoicell_base_2d &c,int i,double x,double y,double r,output_buffer_2d &ob);
+	private:
+		/** The operation codes, with op_literal used for a run of
+		 * plain characters and the remaining codes corresponding to
+		 * the control sequences. */
+		enum op_code {
+			op_literal,op_id,op_x,op_y,op_pos,op_rad,op_nvert,
+			op_verts,op_verts_global,op_maxrad,op_perim,op_edges,
+			op_normals,op_neigh,op_area,op_centroid,
+			op_centroid_global
+		};
+		/** The list of operations, stored as triples of the operation
+		 * code and, for literals, the offset and length of the
+		 * characters in the literal store. */
+		vector<int> ops;
+		/** The characters of all literal runs. */
+		vector<char> lit;
+		void add_literal(char ch);
+		/** Temporary storage for vector-valued statistics. */
+		vector<int> vi;
+		/** Temporary storage for vector-valued statistics. */
+		vector<double> vd;
+};
+
+}
+
+#endif
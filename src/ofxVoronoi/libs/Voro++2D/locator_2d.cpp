@@ -0,0 +1,195 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file locator_2d.cpp
+ * \brief Function implementations for the voronoi_locator_2d class. */
+
+#include <cstdlib>
+
+#include "locator_2d.h"
+
+namespace voro {
+
+/** The class constructor builds the locator from the current contents of a
+ * container.
+ * \param[in] con_ the container to find cells in. */
+voronoi_locator_2d::voronoi_locator_2d(container_2d &con_)
+	: n(0), fallbacks(0), con(con_), walk(!con_.xperiodic&&!con_.yperiodic),
+	pos(NULL), pids(NULL), nst(NULL), nbr(NULL), last(-1), mid(-1), slot(NULL), hg(0), hord(NULL) {
+	build();
+}
+
+/** The class destructor frees the dynamically allocated memory. */
+voronoi_locator_2d::~voronoi_locator_2d() {
+	clear();
+	delete [] hord;
+}
+
+/** Frees the particle positions and neighbor lists. */
+void voronoi_locator_2d::clear() {
+	delete [] slot;slot=NULL;
+	delete [] nbr;nbr=NULL;
+	delete [] nst;nst=NULL;
+	delete [] pids;pids=NULL;
+	delete [] pos;pos=NULL;
+	n=0;mid=-1;last=-1;
+}
+
+/** Reads the particle positions from the container and computes all of the
+ * cells to find their neighbors. For a periodic container, nothing needs to
+ * be stored. */
+void voronoi_locator_2d::build() {
+	clear();
+	if(!walk) return;
+	int k,pid;
+	double *pp;
+	c_loop_all_2d vl(con);
+
+	// Store the positions and IDs of the particles, and make a table of
+	// the particle index of each ID
+	n=con.total_particles();
+	pos=new double[2*n];
+	pids=new int[n];
+	if(vl.start()) {
+		k=0;
+		do {
+			pid=pids[k]=con.id[vl.ij][vl.q];
+			if(pid<0) voro_fatal_error("Voronoi locator requires non-negative particle IDs",VOROPP_INTERNAL_ERROR);
+			if(pid>mid) mid=pid;
+			pp=con.p[vl.ij]+2*vl.q;
+			pos[2*k]=*pp;pos[2*k+1]=pp[1];
+			k++;
+		} while(vl.inc());
+	}
+	slot=new int[mid+1];
+	for(k=0;k<=mid;k++) slot[k]=-1;
+	for(k=0;k<n;k++) {
+		if(slot[pids[k]]!=-1) voro_fatal_error("Voronoi locator requires unique particle IDs",VOROPP_INTERNAL_ERROR);
+		slot[pids[k]]=k;
+	}
+
+	// Compute the cells, storing their neighbors as particle indices
+	voronoicell_neighbor_2d c;
+	vector<int> v,nb;
+	nst=new int[n+1];
+	*nst=0;
+	if(vl.start()) {
+		k=0;
+		do {
+			if(con.compute_cell(c,vl)) {
+				c.neighbors(v);
+				for(vector<int>::iterator it=v.begin();it<v.end();it++)
+					if(*it>=0&&*it<=mid&&slot[*it]!=-1) nb.push_back(slot[*it]);
+			}
+			nst[++k]=nb.size();
+		} while(vl.inc());
+	}
+	nbr=new int[nb.size()>0?nb.size():1];
+	for(k=0;k<int(nb.size());k++) nbr[k]=nb[k];
+}
+
+/** Finds the particle whose Voronoi cell contains a point, by walking from the
+ * particle found by the previous query.
+ * \param[in] (x,y) the point to test.
+ * \param[out] (rx,ry) the position of the particle whose cell contains the
+ *                     point. For a periodic container, this may be a periodic
+ *                     image of the particle.
+ * \param[out] pid the ID of the particle.
+ * \return True if a particle was found, false if the point is outside the
+ *         container or the container is empty. */
+bool voronoi_locator_2d::find(double x,double y,double &rx,double &ry,int &pid) {
+	if(!walk||last==-1) return fallback(x,y,rx,ry,pid);
+	if(x<con.ax||x>=con.bx||y<con.ay||y>=con.by) return false;
+	int s=last,b,k,u,steps=0;
+	double dx=pos[2*s]-x,dy=pos[2*s+1]-y,d=dx*dx+dy*dy,du;
+	while(true) {
+		if(nst[s]==nst[s+1]&&n>1) return fallback(x,y,rx,ry,pid);
+		for(b=s,k=nst[s];k<nst[s+1];k++) {
+			u=nbr[k];
+			dx=pos[2*u]-x;dy=pos[2*u+1]-y;du=dx*dx+dy*dy;
+			if(du<d) {b=u;d=du;}
+		}
+		if(b==s) break;
+		s=b;
+		if(++steps>max_locator_walk_2d) return fallback(x,y,rx,ry,pid);
+	}
+	last=s;
+	rx=pos[2*s];ry=pos[2*s+1];pid=pids[s];
+	return true;
+}
+
+/** Finds the particle whose Voronoi cell contains a point with the container's
+ * grid search, and remembers it as the start of the next walk.
+ * \param[in] (x,y) the point to test.
+ * \param[out] (rx,ry) the position of the particle.
+ * \param[out] pid the ID of the particle.
+ * \return True if a particle was found, false otherwise. */
+bool voronoi_locator_2d::fallback(double x,double y,double &rx,double &ry,int &pid) {
+	fallbacks++;
+	if(!con.find_voronoi_cell(x,y,rx,ry,pid)) return false;
+	if(walk&&pid>=0&&pid<=mid) last=slot[pid];
+	return true;
+}
+
+/** Finds the particles whose Voronoi cells contain a list of points. If
+ * successive points are mostly close together, they are visited in the order
+ * given. Otherwise they are sorted along a Hilbert curve through a coarse grid
+ * over the container, with about one particle per grid cell, so that
+ * successive walks are short. The sort is a counting sort that copies the
+ * points, so that the walks read them in the order they are stored in.
+ * \param[in] m the number of points.
+ * \param[in] xy the points, as (x,y) pairs.
+ * \param[out] pid an array in which to store the ID of the particle found for
+ *                 each point, or -1 if none was found. */
+void voronoi_locator_2d::find_batch(int m,const double *xy,int *pid) {
+	int g=1,k,l,gx,gy,px=-2,py=-2,jumps=0;
+	while(g<locator_batch_max_grid&&(g<locator_batch_min_grid||g*g<n)) g*=2;
+	double rx,ry,sx=g/(con.bx-con.ax),sy=g/(con.by-con.ay),t;
+
+	// Set up the table of Hilbert curve positions of the grid cells
+	if(hg!=g) {
+		delete [] hord;
+		hord=new int[g*g];hg=g;
+		for(k=0;k<g*g;k++) hord[k]=hilbert_index_2d(g,k%g,k/g);
+	}
+
+	// Find the Hilbert curve position of the grid cell of each point,
+	// counting the successive points that are not in the same or adjacent
+	// cells. If there are few, visit the points in order.
+	int *key=new int[m];
+	for(l=0;l<m;l++) {
+		t=(xy[2*l]-con.ax)*sx;gx=t<0?0:(t>=g?g-1:int(t));
+		t=(xy[2*l+1]-con.ay)*sy;gy=t<0?0:(t>=g?g-1:int(t));
+		if(abs(gx-px)>1||abs(gy-py)>1) jumps++;
+		px=gx;py=gy;
+		key[l]=hord[gx+g*gy];
+	}
+	if(jumps*locator_batch_jumps<=m) {
+		delete [] key;
+		for(l=0;l<m;l++) if(!find(xy[2*l],xy[2*l+1],rx,ry,pid[l])) pid[l]=-1;
+		return;
+	}
+
+	// Copy the points in order of their keys with a counting sort
+	struct query {int l;double x,y;} *qs=new query[m],*qp;
+	int *cnt=new int[g*g+1];
+	for(k=0;k<=g*g;k++) cnt[k]=0;
+	for(l=0;l<m;l++) cnt[key[l]+1]++;
+	for(k=0;k<g*g;k++) cnt[k+1]+=cnt[k];
+	for(l=0;l<m;l++) {
+		qp=qs+cnt[key[l]]++;
+		qp->l=l;qp->x=xy[2*l];qp->y=xy[2*l+1];
+	}
+	delete [] cnt;
+	delete [] key;
+	for(l=0;l<m;l++) {
+		k=qs[l].l;
+		if(!find(qs[l].x,qs[l].y,rx,ry,pid[k])) pid[k]=-1;
+	}
+	delete [] qs;
+}
+
+}
@@ -0,0 +1,82 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file locator_2d.h
+ * \brief Header file for the voronoi_locator_2d class. */
+
+#ifndef VOROPP_LOCATOR_2D_HH
+#define VOROPP_LOCATOR_2D_HH
+
+#include "config.h"
+#include "common.h"
+#include "container_2d.h"
+
+namespace voro {
+
+/** \brief A class for finding the Voronoi cells that many points lie in.
+ *
+ * The container's find_voronoi_cell() routine searches the blocks around
+ * every query from scratch. This class instead computes all of the cells
+ * once, and keeps the positions of the particles and the neighbor lists of
+ * their cells. A query starts from the particle found by the previous query,
+ * and repeatedly moves to the neighbor that is closest to the query point,
+ * until no neighbor is closer. Since the container is convex, a particle that
+ * is not the closest to a point always has a neighbor that is closer, so the
+ * walk ends at the particle whose cell contains the point. When successive
+ * queries are close together, as for the pixels of an image, this takes only
+ * a few steps. The first query, and any walk that goes on for too long, use
+ * find_voronoi_cell() instead. Periodic containers always use it, because
+ * the walk does not follow periodic images.
+ *
+ * The particle IDs must be non-negative and unique. Walls are not
+ * considered. If particles are added, removed, or moved, then build() must be
+ * called before the next query. */
+class voronoi_locator_2d {
+	public:
+		/** The number of particles. */
+		int n;
+		/** The number of queries that used find_voronoi_cell(). */
+		int fallbacks;
+		voronoi_locator_2d(container_2d &con_);
+		~voronoi_locator_2d();
+		void build();
+		bool find(double x,double y,double &rx,double &ry,int &pid);
+		void find_batch(int m,const double *xy,int *pid);
+	private:
+		/** The container that the cells are found in. */
+		container_2d &con;
+		/** Whether queries are answered by walking. */
+		const bool walk;
+		/** The particle positions, as (x,y) pairs. */
+		double *pos;
+		/** The particle IDs. */
+		int *pids;
+		/** The index of the start of each particle's neighbor list,
+		 * with one extra entry giving the end of the last list. */
+		int *nst;
+		/** The neighbor lists, as particle indices. */
+		int *nbr;
+		/** The index of the particle found by the last query, or -1
+		 * if there is none. */
+		int last;
+		/** The largest particle ID, or -1 if there are no particles. */
+		int mid;
+		/** The particle index of each ID, or -1 for unused IDs. */
+		int *slot;
+		/** The number of cells along each side of the coarse grid
+		 * that find_batch() last sorted queries on, or 0 if it has not
+		 * been called. */
+		int hg;
+		/** The position along the Hilbert curve of each cell of that
+		 * grid. */
+		int *hord;
+		void clear();
+		bool fallback(double x,double y,double &rx,double &ry,int &pid);
+};
+
+}
+
+#endif
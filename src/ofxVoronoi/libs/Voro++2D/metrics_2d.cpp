@@ -0,0 +1,124 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file metrics_2d.cpp
+ * \brief Function implementations for the cell_metrics_2d class. */
+
+#include <algorithm>
+
+#include "metrics_2d.h"
+#include "scheduler_2d.h"
+
+namespace voro {
+
+/** The class constructor initializes the class with no entries.
+ * \param[in] store_ whether to fill in the per-cell arrays.
+ * \param[in] nbins_ the number of bins in the area histogram, or zero for no
+ *                   histogram.
+ * \param[in] hmax_ the upper limit of the area histogram. */
+cell_metrics_2d::cell_metrics_2d(bool store_,int nbins_,double hmax_)
+	: n(0), computed(0), total_area(0), id(NULL), area(NULL), perimeter(NULL),
+	centroid(NULL), radius(NULL), nbins(nbins_), hmax(hmax_),
+	hist(nbins_>0?new int[nbins_]:NULL), store(store_), mem(0), off(NULL), noff(0) {
+	if(nbins>0&&hmax<=0) voro_fatal_error("Area histogram needs a positive upper limit",VOROPP_INTERNAL_ERROR);
+	for(int k=0;k<nbins;k++) hist[k]=0;
+}
+
+/** The class destructor frees the dynamically allocated memory. */
+cell_metrics_2d::~cell_metrics_2d() {
+	delete [] off;
+	delete [] radius;
+	delete [] centroid;
+	delete [] perimeter;
+	delete [] area;
+	delete [] id;
+	delete [] hist;
+}
+
+/** Works out the index of the first entry of each block, and makes sure that
+ * the per-cell arrays are large enough.
+ * \param[in] nxy the number of blocks.
+ * \param[in] co the number of particles in each block. */
+void cell_metrics_2d::setup(int nxy,int *co) {
+	int ij;
+	if(noff<nxy+1) {
+		delete [] off;
+		off=new int[nxy+1];noff=nxy+1;
+	}
+	for(*off=0,ij=0;ij<nxy;ij++) off[ij+1]=off[ij]+co[ij];
+	n=off[nxy];
+	if(store&&n>mem) {
+		delete [] radius;delete [] centroid;delete [] perimeter;
+		delete [] area;delete [] id;
+		mem=n;
+		id=new int[mem];area=new double[mem];perimeter=new double[mem];
+		centroid=new double[2*mem];radius=new double[mem];
+	}
+}
+
+/** Computes all of the cells of a container and records their metrics. The
+ * entries are handed out to the threads by a range_scheduler_2d, so that a
+ * block holding many more particles than the others is split between
+ * threads.
+ * \param[in] con the container to use. */
+template<class c_class_2d>
+void cell_metrics_2d::compute(c_class_2d &con) {
+	int k;
+	setup(con.nxy,con.co);
+	computed=0;total_area=0;
+	for(k=0;k<nbins;k++) hist[k]=0;
+	range_scheduler_2d rs(n);
+#pragma omp parallel
+	{
+		voro_compute_2d<c_class_2d> vc(con,con.xperiodic?2*con.nx+1:con.nx,con.yperiodic?2*con.ny+1:con.ny);
+		voronoicell_2d c;
+		int i,j,ij,q,l,lo,hi,b,tcomputed=0,*thist=nbins>0?new int[nbins]:NULL;
+		double a,tarea=0,*pp;
+		for(b=0;b<nbins;b++) thist[b]=0;
+		while(rs.next(lo,hi)) {
+			// Find the block holding the first entry of the chunk,
+			// skipping over any empty blocks before it
+			ij=int(upper_bound(off,off+con.nxy+1,lo)-off)-1;
+			q=lo-off[ij];
+			for(l=lo;l<hi;l++,q++) {
+				while(q>=con.co[ij]) {ij++;q=0;}
+				j=ij/con.nx;i=ij-j*con.nx;
+				if(count_deleted_cell_2d(vc.compute_cell(c,ij,q,i,j))) {
+					a=c.area();
+					tarea+=a;tcomputed++;
+					if(nbins>0) {
+						b=int(a*nbins/hmax);
+						thist[b<nbins?b:nbins-1]++;
+					}
+					if(store) {
+						pp=con.p[ij]+con.ps*q;
+						area[l]=a;
+						perimeter[l]=c.perimeter();
+						c.centroid(centroid[2*l],centroid[2*l+1]);
+						centroid[2*l]+=*pp;centroid[2*l+1]+=pp[1];
+						radius[l]=0.5*sqrt(c.max_radius_squared());
+					}
+				} else if(store) {
+					area[l]=perimeter[l]=radius[l]=0;
+					centroid[2*l]=centroid[2*l+1]=0;
+				}
+				if(store) id[l]=con.id[ij][q];
+			}
+		}
+#pragma omp critical
+		{
+			total_area+=tarea;computed+=tcomputed;
+			for(b=0;b<nbins;b++) hist[b]+=thist[b];
+		}
+		delete [] thist;
+	}
+}
+
+// Explicit template instantiation
+template void cell_metrics_2d::compute<container_2d>(container_2d&);
+template void cell_metrics_2d::compute<container_poly_2d>(container_poly_2d&);
+
+}
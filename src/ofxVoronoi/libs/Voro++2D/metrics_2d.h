@@ -0,0 +1,84 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file metrics_2d.h
+ * \brief Header file for the cell_metrics_2d class. */
+
+#ifndef VOROPP_METRICS_2D_HH
+#define VOROPP_METRICS_2D_HH
+
+#include "config.h"
+#include "common.h"
+#include "cell_2d.h"
+#include "container_2d.h"
+
+namespace voro {
+
+/** \brief A class for computing the basic metrics of all cells in one pass.
+ *
+ * This class computes every cell of a container once, and stores its area,
+ * perimeter, centroid, and maximum vertex distance in flat arrays. At the
+ * same time, it adds up the total area and, optionally, bins the cell areas
+ * into a histogram. The entries are stored in the order of the particles in
+ * the container's blocks, so that the entry for the particle at index q of
+ * block ij is at index(ij,q). If the code is compiled with OpenMP, then the
+ * blocks are shared between the threads, each of which keeps its own
+ * computation class and partial sums. */
+class cell_metrics_2d {
+	public:
+		/** The number of entries, equal to the number of particles in
+		 * the container at the last call to compute(). */
+		int n;
+		/** The number of cells that were computed. A cell that is
+		 * removed entirely by a wall has zero entries. */
+		int computed;
+		/** The sum of the areas of all cells. */
+		double total_area;
+		/** The particle ID of each entry. */
+		int *id;
+		/** The area of each cell. */
+		double *area;
+		/** The perimeter of each cell. */
+		double *perimeter;
+		/** The centroid of each cell, as (x,y) pairs in global
+		 * coordinates. */
+		double *centroid;
+		/** The maximum distance from each particle to a vertex of its
+		 * cell. */
+		double *radius;
+		/** The number of bins in the area histogram, or zero if no
+		 * histogram is made. */
+		const int nbins;
+		/** The upper limit of the area histogram. Bin k counts the
+		 * cells with areas in [k*hmax/nbins,(k+1)*hmax/nbins), and the
+		 * last bin also counts any larger cells. */
+		const double hmax;
+		/** The counts of the area histogram. */
+		int *hist;
+		cell_metrics_2d(bool store_=true,int nbins_=0,double hmax_=0);
+		~cell_metrics_2d();
+		template<class c_class_2d>
+		void compute(c_class_2d &con);
+		/** Returns the index of the entry for a particle.
+		 * \param[in] ij the block that the particle is within.
+		 * \param[in] q the index of the particle within the block. */
+		inline int index(int ij,int q) {return off[ij]+q;}
+	private:
+		/** Whether the per-cell arrays are filled in. If not, only the
+		 * total area and histogram are computed. */
+		const bool store;
+		/** The current size of the per-cell arrays. */
+		int mem;
+		/** The index of the first entry of each block. */
+		int *off;
+		/** The number of blocks that the offsets are allocated for. */
+		int noff;
+		void setup(int nxy,int *co);
+};
+
+}
+
+#endif
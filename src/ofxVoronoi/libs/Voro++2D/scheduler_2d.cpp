@@ -0,0 +1,88 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file scheduler_2d.cpp
+ * \brief Function implementations for the range_scheduler_2d class. */
+
+#include "common.h"
+#include "scheduler_2d.h"
+
+namespace voro {
+
+/** The class constructor splits the items evenly between the maximum number
+ * of threads. It must be called outside the parallel region that uses it.
+ * \param[in] n the number of items.
+ * \param[in] grain_ the number of items taken from a range at a time. */
+range_scheduler_2d::range_scheduler_2d(int n,int grain_)
+	: nt(voro_max_threads()), grain(grain_), r(new range[nt]) {
+	if(grain<1) voro_fatal_error("Scheduler grain size must be positive",VOROPP_INTERNAL_ERROR);
+	for(int t=0;t<nt;t++) {
+		r[t].lo=int((long long) n*t/nt);
+		r[t].hi=int((long long) n*(t+1)/nt);
+	}
+}
+
+/** The class destructor frees the dynamically allocated memory. */
+range_scheduler_2d::~range_scheduler_2d() {
+	delete [] r;
+}
+
+/** Gives the current thread its next chunk of items, stealing from another
+ * thread if its own range is empty.
+ * \param[out] (lo,hi) the chunk, from item lo up to but not including item
+ *                     hi.
+ * \return True if a chunk was found, false if there are no items left. */
+bool range_scheduler_2d::next(int &lo,int &hi) {
+	int t=voro_thread_num();
+	range &o=r[t];
+	do {
+		std::lock_guard<std::mutex> g(o.m);
+		if(o.lo<o.hi) {
+			lo=o.lo;
+			hi=o.hi-o.lo>grain?o.lo+grain:o.hi;
+			o.lo=hi;
+			return true;
+		}
+	} while(steal(t));
+	return false;
+}
+
+/** Moves the back half of the largest remaining range of another thread into
+ * the range of a thread, which must be empty. Items in transit between two
+ * ranges are not seen by other threads, so a thread may occasionally finish
+ * while another still has a few chunks to do, but every item is taken exactly
+ * once.
+ * \param[in] t the thread to steal for.
+ * \return True if any items were stolen, false if all ranges were empty. */
+bool range_scheduler_2d::steal(int t) {
+	int k,v,rem,best,lo,hi;
+	do {
+		// Find the thread with the most items left
+		v=-1;best=0;
+		for(k=0;k<nt;k++) if(k!=t) {
+			std::lock_guard<std::mutex> g(r[k].m);
+			rem=r[k].hi-r[k].lo;
+			if(rem>best) {v=k;best=rem;}
+		}
+		if(v==-1) return false;
+
+		// Take the back half of its range, which may have shrunk
+		// since it was looked at
+		{
+			std::lock_guard<std::mutex> g(r[v].m);
+			rem=r[v].hi-r[v].lo;
+			if(rem<=0) continue;
+			hi=r[v].hi;
+			lo=r[v].lo+rem/2;
+			r[v].hi=lo;
+		}
+		std::lock_guard<std::mutex> g(r[t].m);
+		r[t].lo=lo;r[t].hi=hi;
+		return true;
+	} while(true);
+}
+
+}
@@ -0,0 +1,82 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file scheduler_2d.h
+ * \brief Header file for the range_scheduler_2d class. */
+
+#ifndef VOROPP_SCHEDULER_2D_HH
+#define VOROPP_SCHEDULER_2D_HH
+
+#include <mutex>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "config.h"
+
+namespace voro {
+
+/** Returns the maximum number of threads that a parallel region can use, which
+ * is one if the code is not compiled with OpenMP. */
+inline int voro_max_threads() {
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+/** Returns the number of the current thread within a parallel region, which is
+ * zero if the code is not compiled with OpenMP. */
+inline int voro_thread_num() {
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+/** \brief A work-stealing scheduler for a range of items.
+ *
+ * The items 0 to n-1 are initially split into one contiguous range per
+ * thread. Each thread takes small chunks of items from the front of its own
+ * range, so that the items it handles are close together in memory. When its
+ * range is empty, it steals the back half of the largest remaining range of
+ * another thread, and carries on from there. A thread whose items are much
+ * more expensive than the others therefore has its work taken over gradually,
+ * rather than holding up the rest at the end. Each range has its own lock,
+ * and no thread ever holds two locks at once. */
+class range_scheduler_2d {
+	public:
+		/** The number of ranges, one per thread. */
+		const int nt;
+		/** The number of items taken from a range at a time. */
+		const int grain;
+		range_scheduler_2d(int n,int grain_=schedule_grain_2d);
+		~range_scheduler_2d();
+		bool next(int &lo,int &hi);
+	private:
+		/** \brief The range of items still to be taken by a thread. */
+		struct range {
+			/** The lock protecting the range. */
+			std::mutex m;
+			/** The first item of the range. */
+			int lo;
+			/** One past the last item of the range. */
+			int hi;
+			/** Padding, so that the ranges of different threads
+			 * do not share a cache line. */
+			char pad[64];
+		};
+		/** The ranges of the threads. */
+		range *r;
+		bool steal(int t);
+};
+
+}
+
+#endif
@@ -0,0 +1,241 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file tiled_2d.cpp
+ * \brief Function implementations for the tiled, out-of-core tessellation
+ * driver. */
+
+#include <algorithm>
+#include <cstring>
+
+#include "tiled_2d.h"
+
+namespace voro {
+
+/** The class constructor sets up the geometry of the tile grid.
+ * \param[in] (ax_,bx_) the minimum and maximum x coordinates of the domain.
+ * \param[in] (ay_,by_) the minimum and maximum y coordinates of the domain.
+ * \param[in] (nx_,ny_) the number of tiles in the x and y directions.
+ * \param[in] halo_ the initial width of the halo margin around each tile. */
+tiled_tessellation_2d::tiled_tessellation_2d(double ax_,double bx_,double ay_,double by_,
+		int nx_,int ny_,double halo_)
+	: ax(ax_), bx(bx_), ay(ay_), by(by_), nx(nx_), ny(ny_), halo(halo_), retries(0),
+	boxx((bx_-ax_)/nx_), boxy((by_-ay_)/ny_), sf(NULL), cap(0),
+	tn(new long long[nx_*ny_]), bo(new vector<long long>[nx_*ny_]) {
+	if(halo<=0) voro_fatal_error("Tile halo width must be positive",VOROPP_INTERNAL_ERROR);
+	for(int t=0;t<nx*ny;t++) tn[t]=0;
+}
+
+/** The class destructor closes the spill file, which causes it to be deleted,
+ * and frees the dynamically allocated memory. */
+tiled_tessellation_2d::~tiled_tessellation_2d() {
+	if(sf!=NULL) fclose(sf);
+	delete [] bo;
+	delete [] tn;
+}
+
+/** Reads a binary particle file and distributes its particles into the tiles.
+ * Each particle is given to the tile that it lies in, and to every other tile
+ * whose halo it lies in. The particles of each tile are collected in a buffer
+ * holding one block, which is appended to the spill file whenever it is full,
+ * so that only a single temporary file is needed however many tiles there
+ * are. Particles outside the domain are discarded, as are any radii stored in
+ * the file.
+ * \param[in] filename the name of the binary particle file. */
+void tiled_tessellation_2d::partition(const char *filename) {
+	int t,i,j,i0,i1,j0,j1,l,*bn=new int[nx*ny];
+	long long pos=0;
+	double x,y;
+	const char *rp;
+
+	// Create the spill file, and size the blocks so that the buffers of
+	// all the tiles together stay within a fixed budget
+	if(sf!=NULL) fclose(sf);
+	sf=tmpfile();
+	if(sf==NULL) voro_fatal_error("Unable to create temporary spill file",VOROPP_FILE_ERROR);
+	cap=tile_spill_buffer/(20*nx*ny);
+	if(cap<min_tile_block) cap=min_tile_block;
+	char *buf=new char[size_t(20)*cap*nx*ny];
+	for(t=0;t<nx*ny;t++) {tn[t]=0;bn[t]=0;bo[t].clear();}
+
+	// Stream the particles into every tile whose halo they lie in
+	particle_stream_2d ps(filename);
+	while(ps.next_chunk()) {
+		for(rp=ps.buf,l=0;l<ps.count;l++,rp+=ps.h.rsize) {
+			memcpy(&x,rp+4,8);memcpy(&y,rp+12,8);
+			if(x<ax||x>bx||y<ay||y>by) continue;
+			i0=tile_x(x-halo);i1=tile_x(x+halo);
+			j0=tile_y(y-halo);j1=tile_y(y+halo);
+			for(j=j0;j<=j1;j++) for(i=i0;i<=i1;i++) {
+				t=i+nx*j;
+				memcpy(buf+20*(size_t(cap)*t+bn[t]),rp,20);
+				tn[t]++;
+				if(++bn[t]==cap) {append_block(t,buf+size_t(20)*cap*t,cap,pos);bn[t]=0;}
+			}
+		}
+	}
+	for(t=0;t<nx*ny;t++) if(bn[t]>0) append_block(t,buf+size_t(20)*cap*t,bn[t],pos);
+	delete [] buf;
+	delete [] bn;
+}
+
+/** Appends a block of particle records to the end of the spill file.
+ * \param[in] t the tile that the block belongs to.
+ * \param[in] buf the records.
+ * \param[in] m the number of records.
+ * \param[in,out] pos the size of the spill file in bytes, which is updated. */
+void tiled_tessellation_2d::append_block(int t,const char *buf,int m,long long &pos) {
+	if(fwrite(buf,20,m,sf)!=size_t(m))
+		voro_fatal_error("Unable to write temporary spill file",VOROPP_FILE_ERROR);
+	bo[t].push_back(pos);
+	pos+=20*m;
+}
+
+/** Computes the tessellation of all tiles and writes it to a binary
+ * tessellation file. The spill file is kept until partition() is called again
+ * or the class is destroyed, so the tessellation can be computed repeatedly.
+ * \param[in] fp a file handle to write to, which must be seekable.
+ * \param[in] flags the flags selecting the record layout. */
+void tiled_tessellation_2d::compute(FILE *fp,unsigned int flags) {
+	if(sf==NULL) voro_fatal_error("Tiled tessellation computed before partitioning",VOROPP_INTERNAL_ERROR);
+	tessellation_writer_2d tw(fp,flags);
+	int t;
+	retries=0;
+#pragma omp parallel for schedule(dynamic)
+	for(t=0;t<nx*ny;t++) compute_tile(t%nx,t/nx,tw);
+	tw.finish();
+}
+
+/** Loads the particles of a tile from the spill file into a container, one
+ * block at a time.
+ * \param[in] con the container to load the particles into.
+ * \param[in] t the tile.
+ * \param[in] owned whether to only load the particles that lie in the tile
+ *                  itself and inside the container, rather than all of the
+ *                  tile's particles including its halo. */
+void tiled_tessellation_2d::load_tile(container_2d &con,int t,bool owned) {
+	int i=t%nx,j=t/nx,k,l,m,nb=bo[t].size();
+	double x,y;
+	char *buf=new char[size_t(20)*cap],*rp,*wp;
+	for(k=0;k<nb;k++) {
+		m=k<nb-1?cap:int(tn[t]-(long long) k*cap);
+#pragma omp critical(tiled_spill)
+		{
+			if(fseek(sf,long(bo[t][k]),SEEK_SET)!=0||fread(buf,20,m,sf)!=size_t(m))
+				voro_fatal_error("Unable to read temporary spill file",VOROPP_FILE_ERROR);
+		}
+
+		// Keep only the owned particles, compacting the block in place
+		if(owned) {
+			for(rp=wp=buf,l=0;l<m;l++,rp+=20) {
+				memcpy(&x,rp+4,8);memcpy(&y,rp+12,8);
+				if(tile_x(x)!=i||tile_y(y)!=j||x<con.ax||x>con.bx||y<con.ay||y>con.by) continue;
+				if(wp!=rp) memcpy(wp,rp,20);
+				wp+=20;
+			}
+			m=int((wp-buf)/20);
+		}
+		con.put_binary(buf,m);
+	}
+	delete [] buf;
+}
+
+/** Creates a container covering a tile and its halo, clipped to the domain,
+ * with a block grid sized for the expected number of particles.
+ * \param[in] (i,j) the tile to create a container for.
+ * \param[in] hw the halo width.
+ * \param[in] n the expected number of particles.
+ * \return A pointer to the new container. */
+container_2d* tiled_tessellation_2d::tile_container(int i,int j,double hw,long long n) {
+	double lx=max(ax,ax+i*boxx-hw),ux=min(bx,ax+(i+1)*boxx+hw),
+	       ly=max(ay,ay+j*boxy-hw),uy=min(by,ay+(j+1)*boxy+hw),
+	       ilscale=sqrt(double(n)/(optimal_particles_2d*(ux-lx)*(uy-ly)));
+	int bnx=int((ux-lx)*ilscale)+1,bny=int((uy-ly)*ilscale)+1;
+	return new container_2d(lx,ux,ly,uy,bnx,bny,false,false,8);
+}
+
+/** Computes the cells of the particles owned by a tile, writing out those
+ * that are guaranteed to be correct.
+ * \param[in] con the container holding the tile and its halo.
+ * \param[in] (i,j) the tile.
+ * \param[in] hw the halo width that the container was created with.
+ * \param[in] sel a sorted list of particle IDs to restrict the computation
+ *                to, or NULL to compute all the particles owned by the tile.
+ * \param[out] fail a list to append the IDs of the particles whose cells
+ *                  could not be guaranteed to.
+ * \param[in] tw the tessellation writer to send the cells to.
+ * \return The number of cells written. */
+template<class v_cell_2d>
+int tiled_tessellation_2d::compute_owned(v_cell_2d &c,container_2d &con,int i,int j,double hw,
+		vector<int> *sel,vector<int> &fail,tessellation_writer_2d &tw) {
+	int pid,count=0;
+	double x,y,d,dmin,
+	       lx=ax+i*boxx-hw,ux=ax+(i+1)*boxx+hw,
+	       ly=ay+j*boxy-hw,uy=ay+(j+1)*boxy+hw;
+	c_loop_all_2d vl(con);
+	if(vl.start()) do {
+		vl.pos(x,y);pid=vl.pid();
+		if(tile_x(x)!=i||tile_y(y)!=j) continue;
+		if(sel!=NULL&&!binary_search(sel->begin(),sel->end(),pid)) continue;
+		if(!con.compute_cell(c,vl)) continue;
+
+		// Find the distance to the nearest edge of the loaded region
+		// that is not a domain wall, and check that no particle
+		// outside the region could cut the cell
+		dmin=large_number;
+		if(lx>ax) {d=x-lx;if(d<dmin) dmin=d;}
+		if(ux<bx) {d=ux-x;if(d<dmin) dmin=d;}
+		if(ly>ay) {d=y-ly;if(d<dmin) dmin=d;}
+		if(uy<by) {d=uy-y;if(d<dmin) dmin=d;}
+		if(dmin*dmin<c.max_radius_squared()) {fail.push_back(pid);continue;}
+#pragma omp critical
+		tw.add(c,pid,x,y);
+		count++;
+	} while(vl.inc());
+	return count;
+}
+
+/** Computes the cells of a single tile. The tile is first computed from its
+ * particles in the spill file. Any cells that cannot be guaranteed to be
+ * correct are then recomputed with the halo width doubled each time, until
+ * all cells are guaranteed. Each retry loads the particles owned by the tiles
+ * that overlap the widened region, so only the spill file blocks of those
+ * tiles are read.
+ * \param[in] (i,j) the tile to compute.
+ * \param[in] tw the tessellation writer to send the cells to. */
+void tiled_tessellation_2d::compute_tile(int i,int j,tessellation_writer_2d &tw) {
+	int t=i+nx*j,ii,jj,i0,i1,j0,j1;
+	long long n=tn[t];
+	double hw=halo,a=(boxx+2*halo)*(boxy+2*halo);
+	vector<int> fail,sel;
+	voronoicell_2d c;
+	voronoicell_neighbor_2d cn;
+
+	// Compute the tile from its own particles and their halo
+	container_2d *con=tile_container(i,j,hw,n);
+	load_tile(*con,t,false);
+	if(tw.neighbor()) compute_owned(cn,*con,i,j,hw,NULL,fail,tw);
+	else compute_owned(c,*con,i,j,hw,NULL,fail,tw);
+	delete con;
+
+	// Recompute any cells that were not guaranteed, with a wider halo
+	while(!fail.empty()) {
+		hw*=2;
+#pragma omp atomic
+		retries++;
+		sel.swap(fail);fail.clear();
+		sort(sel.begin(),sel.end());
+		con=tile_container(i,j,hw,(long long) (n*(boxx+2*hw)*(boxy+2*hw)/a));
+		i0=tile_x(con->ax);i1=tile_x(con->bx);
+		j0=tile_y(con->ay);j1=tile_y(con->by);
+		for(jj=j0;jj<=j1;jj++) for(ii=i0;ii<=i1;ii++) load_tile(*con,ii+nx*jj,true);
+		if(tw.neighbor()) compute_owned(cn,*con,i,j,hw,&sel,fail,tw);
+		else compute_owned(c,*con,i,j,hw,&sel,fail,tw);
+		delete con;
+	}
+}
+
+}
@@ -0,0 +1,118 @@
+// Voro++, a 2D and 3D cell-based Voronoi library
+//
+// Author   : agent
+// Email    : agent@local
+// Date     : October 19th 2026
+
+/** \file tiled_2d.h
+ * \brief Header file for the tiled, out-of-core tessellation driver. */
+
+#ifndef VOROPP_TILED_2D_HH
+#define VOROPP_TILED_2D_HH
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+#include "config.h"
+#include "common.h"
+#include "binary_io_2d.h"
+#include "container_2d.h"
+
+namespace voro {
+
+/** \brief A driver for computing very large tessellations tile by tile.
+ *
+ * A container_2d needs every particle to be resident in memory. This class
+ * instead splits a rectangular, non-periodic domain into a grid of tiles. The
+ * particles are read from a binary particle file and distributed into a
+ * single temporary spill file, where each tile's particles are appended in
+ * blocks as they are collected, and each tile also receives copies of the
+ * particles within a halo margin around it. Each tile is then loaded into its
+ * own container, and the cells of the particles that it owns are streamed to
+ * a binary tessellation file, so that the peak memory usage is set by the
+ * size of a tile rather than the total number of particles.
+ *
+ * A cell is only written if it is guaranteed to be correct, which is the case
+ * if the particle is at least twice the cell's maximum vertex distance away
+ * from every edge of the loaded region that is not a domain wall. Cells that
+ * fail this test are recomputed with the halo repeatedly doubled, by
+ * reloading the particles owned by the tiles that the widened region
+ * overlaps. If the code is compiled with OpenMP, then the tiles are
+ * computed in parallel. */
+class tiled_tessellation_2d {
+	public:
+		/** The minimum x coordinate of the domain. */
+		const double ax;
+		/** The maximum x coordinate of the domain. */
+		const double bx;
+		/** The minimum y coordinate of the domain. */
+		const double ay;
+		/** The maximum y coordinate of the domain. */
+		const double by;
+		/** The number of tiles in the x direction. */
+		const int nx;
+		/** The number of tiles in the y direction. */
+		const int ny;
+		/** The width of the halo margin around each tile. */
+		const double halo;
+		/** The number of times that a tile had to be recomputed with
+		 * a wider halo. */
+		int retries;
+		tiled_tessellation_2d(double ax_,double bx_,double ay_,double by_,
+				int nx_,int ny_,double halo_);
+		~tiled_tessellation_2d();
+		void partition(const char *filename);
+		void compute(FILE *fp,unsigned int flags=0);
+		/** Computes the tessellation and saves it to a binary
+		 * tessellation file.
+		 * \param[in] filename the name of the file to write to.
+		 * \param[in] flags the flags selecting the record layout. */
+		inline void compute(const char *filename,unsigned int flags=0) {
+			FILE *fp=safe_fopen(filename,"wb");
+			compute(fp,flags);
+			fclose(fp);
+		}
+	private:
+		/** The width of a tile. */
+		const double boxx;
+		/** The height of a tile. */
+		const double boxy;
+		/** The temporary file holding the particles of every tile, or
+		 * NULL if the particles have not been partitioned. */
+		FILE *sf;
+		/** The number of particle records in a full block of the spill
+		 * file. */
+		int cap;
+		/** The number of particle records of each tile. */
+		long long *tn;
+		/** The byte offsets of the blocks of each tile in the spill
+		 * file. Every block but the last one of a tile is full. */
+		vector<long long> *bo;
+		/** Returns the tile column that a coordinate lies in.
+		 * \param[in] x the coordinate.
+		 * \return The column, clamped to the valid range. */
+		inline int tile_x(double x) {
+			int i=int((x-ax)/boxx);
+			return i<0?0:(i>=nx?nx-1:i);
+		}
+		/** Returns the tile row that a coordinate lies in.
+		 * \param[in] y the coordinate.
+		 * \return The row, clamped to the valid range. */
+		inline int tile_y(double y) {
+			int j=int((y-ay)/boxy);
+			return j<0?0:(j>=ny?ny-1:j);
+		}
+		container_2d* tile_container(int i,int j,double hw,long long n);
+		void append_block(int t,const char *buf,int m,long long &pos);
+		void load_tile(container_2d &con,int t,bool owned);
+		void compute_tile(int i,int j,tessellation_writer_2d &tw);
+		template<class v_cell_2d>
+		int compute_owned(v_cell_2d &c,container_2d &con,int i,int j,double hw,
+				vector<int> *sel,vector<int> &fail,tessellation_writer_2d &tw);
+};
+
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include "rad_option.h"
 #include "container_2d.h"
 #include "ctr_boundary_2d.h"
+#include "counters_2d.h"
 
 namespace voro {
 
@@ -380,6 +381,7 @@ bool voro_compute_2d<c_class_2d>::compute_cell(v_cell_2d &c,int ij,int s,int ci,
 		// Now compute which region we are going to loop over, adding a
 		// displacement for the periodic cases
 		ij=con.region_index(ci,cj,ei,ej,qx,qy,disp);
+		VOROPP_COUNT(worklist_blocks);
 		if(!con.boundary_cuts(c,ij,x,y)) return false;
 
 		// If mrs is bigger than the maximum distance to the block,
@@ -465,6 +467,7 @@ bool voro_compute_2d<c_class_2d>::compute_cell(v_cell_2d &c,int ij,int s,int ci,
 		// Now compute which region we are going to loop over, adding a
 		// displacement for the periodic cases
 		ij=con.region_index(ci,cj,ei,ej,qx,qy,disp);
+		VOROPP_COUNT(worklist_blocks);
 		if(!con.boundary_cuts(c,ij,x,y)) return false;
 
 		// If mrs is bigger than the maximum distance to the block,
@@ -551,6 +554,7 @@ bool voro_compute_2d<c_class_2d>::compute_cell(v_cell_2d &c,int ij,int s,int ci,
 		// Now compute the region that we are going to test over, and
 		// set a displacement vector for the periodic cases
 		ij=con.region_index(ci,cj,ei,ej,qx,qy,disp);
+		VOROPP_COUNT(search_blocks);
 		if(!con.boundary_cuts(c,ij,x,y)) return false;
 
 		// Loop over all the elements in the block to test for cuts. It
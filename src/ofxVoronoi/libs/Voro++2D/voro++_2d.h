@@ -12,5 +12,12 @@
 #include "wall_2d.h"
 #include "cell_nc_2d.h"
 #include "ctr_boundary_2d.h"
+#include "binary_io_2d.h"
+#include "format_2d.h"
+#include "tiled_2d.h"
+#include "metrics_2d.h"
+#include "scheduler_2d.h"
+#include "locator_2d.h"
+#include "counters_2d.h"
 
 #endif
@@ -12,9 +12,13 @@
 #include "wall_2d.h"
 #include "cell_nc_2d.h"
 #include "ctr_boundary_2d.h"
+#include "counters_2d.h"
 
 //--------------------------------------------------------------
-ofxVoronoi::ofxVoronoi() {}
+ofxVoronoi::ofxVoronoi() : cacheEnabled(true), lastHit(-1), lastRecomputed(0) {
+    beginStats();
+    endStats();
+}
 
 //--------------------------------------------------------------
 ofxVoronoi::~ofxVoronoi() {}
@@ -22,57 +26,185 @@ ofxVoronoi::~ofxVoronoi() {}
 //--------------------------------------------------------------
 void ofxVoronoi::clear() {
     cells.clear();
+    cellIndex.clear();
     points.clear();
 }
 
+//--------------------------------------------------------------
+void ofxVoronoi::clearCache() {
+    con.reset();
+    cachePoints.clear();
+    cache.clear();
+}
+
 //--------------------------------------------------------------
 void ofxVoronoi::generate(bool ordered) {
-    voro::container_2d* con = new voro::container_2d(bounds.x, bounds.x+bounds.getWidth(), bounds.y, bounds.y+bounds.getHeight(), 10, 10, false, false, 16);
-    voro::c_loop_all_2d* vl = new voro::c_loop_all_2d(*con);
-    voro::voronoicell_2d conCell;
+    if(!cacheEnabled) {
+        clearCache();
+    }
+    beginStats();
+    syncContainer();
+    computeDirtyCells();
+    collectCells(ordered);
+    endStats();
+}
+
+//--------------------------------------------------------------
+void ofxVoronoi::beginStats() {
+    // The counters are shared by all containers, so they only describe
+    // this generator if no other computation runs at the same time
+    voro::reset_counters_2d();
+}
+
+//--------------------------------------------------------------
+void ofxVoronoi::endStats() {
+    voro::voro_counters_2d counters;
+    voro::collect_counters_2d(counters);
+    stats.countersEnabled = VOROPP_COUNTERS != 0;
+    stats.cellsComputed = lastRecomputed;
+    stats.planeTests = counters.nplane;
+    stats.planeCuts = counters.nplane_cut;
+    stats.worklistBlocks = counters.worklist_blocks;
+    stats.searchBlocks = counters.search_blocks;
+    stats.vertexGrowth = counters.vertex_growth;
+    stats.deleteStackGrowth = counters.delete_growth;
+    stats.particleGrowth = counters.particle_growth;
+    stats.deletedCells = counters.deleted_cells;
+}
+
+//--------------------------------------------------------------
+void ofxVoronoi::syncContainer() {
+    // Rebuild everything if the bounds changed, otherwise apply the
+    // differences between the cached and the current points
+    if(!con || cacheBounds != bounds) {
+        con.reset(new voro::container_2d(bounds.x, bounds.x+bounds.getWidth(), bounds.y, bounds.y+bounds.getHeight(), 10, 10, false, false, 16));
+        cacheBounds = bounds;
         
+        // Every cell of a new container is computed anyway, so fill it
+        // before enabling tracking to skip the per-insertion search
+        for(int i=0; i<points.size(); i++) {
+            con->put(i, points[i].x, points[i].y);
+        }
+        con->enable_tracking();
+        cachePoints = points;
+        cache.assign(points.size(), ofxVoronoiCell());
+        for(int i=0; i<points.size(); i++) {
+            cache[i].pt = points[i];
+        }
+        return;
+    }
+    int oldSize = cachePoints.size();
+    
+    for(int i=points.size(); i<cachePoints.size(); i++) {
+        con->remove(i);
+    }
+    cachePoints.resize(points.size());
+    cache.resize(points.size());
+    
     for(int i=0; i<points.size(); i++) {
+        if(i >= oldSize || points[i] != cachePoints[i]) {
+            syncPoint(i);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+void ofxVoronoi::syncPoint(int i) {
+    int ij, q;
+    if(con->find_particle(i, ij, q)) {
+        con->move(i, points[i].x, points[i].y);
+    } else {
         con->put(i, points[i].x, points[i].y);
     }
+    cachePoints[i] = points[i];
     
-    if(vl->start()) {
+    // Points outside the bounds have no cell
+    if(!con->find_particle(i, ij, q)) {
+        cache[i].pts.clear();
+        cache[i].neighbors.clear();
+        cache[i].pt = points[i];
+        cache[i].area = cache[i].perimeter = cache[i].radius = 0;
+        cache[i].centroid = points[i];
+    }
+}
+
+//--------------------------------------------------------------
+void ofxVoronoi::computeDirtyCells() {
+    voro::particle_order order;
+    con->take_dirty(order);
+    voro::c_loop_order_2d vl(*con, order);
+    
+    lastRecomputed = 0;
+    if(vl.start()) {
         do {
-            con->compute_cell(conCell, *vl);
-            int k = 0;
-            
-            if(conCell.p) {
-                ofxVoronoiCell newCell = ofxVoronoiCell();
-                
-                // Get the current point of the cell
-                double* currentPoint = con->p[vl->ij]+con->ps*vl->q;
-                newCell.pt = ofPoint(currentPoint[0], currentPoint[1]);
-                
-                // Get the edgepoints of the cell
-                do {
-                    float x = currentPoint[0] + 0.5 * conCell.pts[2*k];
-                    float y = currentPoint[1] + 0.5 * conCell.pts[2*k+1];
-                    
-                    ofPoint pt = ofPoint(x, y);
-                    newCell.pts.push_back(pt);
-                    
-                    k = conCell.ed[2*k];
-                } while(k!=0);
-                
-                cells.push_back(newCell);
-            }
-        } while(vl->inc());
+            computeCell(vl.ij, vl.q);
+        } while(vl.inc());
     }
+}
+
+//--------------------------------------------------------------
+void ofxVoronoi::computeCell(int ij, int q) {
+    voro::voronoicell_neighbor_2d conCell;
+    int id = con->id[ij][q];
+    ofxVoronoiCell& cell = cache[id];
+    cell.pts.clear();
+    cell.neighbors.clear();
     
-    // free up the memory
-    delete con, vl;
+    // Get the current point of the cell
+    double* currentPoint = con->p[ij]+con->ps*q;
+    cell.pt = ofPoint(currentPoint[0], currentPoint[1]);
+    cell.area = cell.perimeter = cell.radius = 0;
+    cell.centroid = cell.pt;
+    
+    if(con->compute_cell(conCell, ij, q) && conCell.p) {
+        con->record_cell(id, conCell);
+        conCell.neighbors(cell.neighbors);
+        
+        // Get the metrics while the cell is at hand
+        double cx, cy;
+        conCell.centroid(cx, cy);
+        cell.area = conCell.area();
+        cell.perimeter = conCell.perimeter();
+        cell.centroid = ofPoint(currentPoint[0] + cx, currentPoint[1] + cy);
+        cell.radius = 0.5 * sqrt(conCell.max_radius_squared());
+        
+        // Get the edgepoints of the cell
+        int k = 0;
+        do {
+            float x = currentPoint[0] + 0.5 * conCell.pts[2*k];
+            float y = currentPoint[1] + 0.5 * conCell.pts[2*k+1];
+            cell.pts.push_back(ofPoint(x, y));
+            k = conCell.ed[2*k];
+        } while(k!=0);
+    }
+    lastRecomputed++;
+}
+
+//--------------------------------------------------------------
+void ofxVoronoi::collectCells(bool ordered) {
+    cells.clear();
+    cellIndex.assign(points.size(), -1);
     
+    // The cache is indexed by point id, so it is already in point order
     if(ordered) {
-        vector<ofxVoronoiCell> orderedCells;
-        for(auto& pt : points) {
-//            ofLog() << pt;
-            orderedCells.push_back(getCell(pt));
+        for(int i=0; i<points.size(); i++) {
+            cellIndex[i] = cells.size();
+            cells.push_back(cache[i]);
         }
-        cells = orderedCells;
+        return;
+    }
+    
+    // Otherwise list the points that have a cell in the order of the
+    // container's blocks, like a plain loop over the container does
+    voro::c_loop_all_2d vl(*con);
+    if(vl.start()) {
+        do {
+            int id = con->id[vl.ij][vl.q];
+            if(!cache[id].pts.empty()) {
+                cellIndex[id] = cells.size();
+                cells.push_back(cache[id]);
+            }
+        } while(vl.inc());
     }
 }
 
@@ -160,11 +292,7 @@ vector <ofxVoronoiCell>& ofxVoronoi::getCells() {
 void ofxVoronoi::relax(){
     vector<ofPoint> relaxPts;
     for(int i=0; i<cells.size(); i++) {
-        ofPolyline p;
-        p.addVertices(cells[i].pts);
-        p.close();
-        ofPoint centroid = p.getCentroid2D();
-        relaxPts.push_back(centroid);
+        relaxPts.push_back(cells[i].centroid);
     }
     clear();
     points = relaxPts;
@@ -174,16 +302,23 @@ void ofxVoronoi::relax(){
 //--------------------------------------------------------------
 ofxVoronoiCell& ofxVoronoi::getCell(ofPoint _point, bool approximate) {
     if(approximate) {
-        ofxVoronoiCell& nearestCell = cells[0];
+        int i = walkToCell(_point);
+        if(i >= 0) {
+            return cells[cellIndex[i]];
+        }
+        
+        // Outside the bounds, or without a cache to walk over, check
+        // every cell
+        int nearest = 0;
         float nearestDistance = numeric_limits<float>::infinity();
-        for(ofxVoronoiCell& cell : cells) {
-            float distance = _point.squareDistance(cell.pt);
+        for(int k=0; k<cells.size(); k++) {
+            float distance = _point.squareDistance(cells[k].pt);
             if(distance < nearestDistance) {
                 nearestDistance = distance;
-                nearestCell = cell;
+                nearest = k;
             }
         }
-        return nearestCell;
+        return cells[nearest];
     } else {
         for(ofxVoronoiCell& cell : cells) {
             if(_point == cell.pt) {
@@ -195,5 +330,70 @@ ofxVoronoiCell& ofxVoronoi::getCell(ofPoint _point, bool approximate) {
     }
 }
 
+//--------------------------------------------------------------
+int ofxVoronoi::walkToCell(ofPoint _point) {
+    // The cache has to describe the cells that were last collected
+    if(cache.size() != points.size() || cellIndex.size() != cache.size() || !bounds.inside(_point)) {
+        return -1;
+    }
+    
+    // Start from the cell found last, which for successive pixels or
+    // mouse positions is usually the answer or a neighbour of it
+    int i = lastHit;
+    if(i < 0 || i >= cache.size() || cache[i].pts.empty()) {
+        for(i=0; i<cache.size() && cache[i].pts.empty(); i++) {}
+        if(i == cache.size()) {
+            return -1;
+        }
+    }
+    
+    // Move to the neighbour nearest to the point until none is nearer.
+    // Inside the bounds a seed that is not the nearest always has a
+    // nearer neighbour, so this ends at the cell holding the point
+    float distance = _point.squareDistance(cache[i].pt);
+    while(true) {
+        int best = i;
+        for(int n : cache[i].neighbors) {
+            if(n < 0 || n >= cache.size()) {
+                continue;
+            }
+            float d = _point.squareDistance(cache[n].pt);
+            if(d < distance) {
+                distance = d;
+                best = n;
+            }
+        }
+        if(best == i) {
+            break;
+        }
+        i = best;
+    }
+    if(cellIndex[i] < 0) {
+        return -1;
+    }
+    lastHit = i;
+    return i;
+}
+
+//--------------------------------------------------------------
+void ofxVoronoi::setCacheEnabled(bool _enabled) {
+    cacheEnabled = _enabled;
+    if(!cacheEnabled) {
+        clearCache();
+    }
+}
 
+//--------------------------------------------------------------
+bool ofxVoronoi::isCacheEnabled() {
+    return cacheEnabled;
+}
 
+//--------------------------------------------------------------
+int ofxVoronoi::getLastRecomputedCount() {
+    return lastRecomputed;
+}
+
+//--------------------------------------------------------------
+const ofxVoronoiStats& ofxVoronoi::getStats() {
+    return stats;
+}
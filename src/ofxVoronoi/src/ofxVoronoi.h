@@ -3,10 +3,39 @@
 // openFrameworks
 #include "ofMain.h"
 
+namespace voro {
+    class container_2d;
+}
+
 class ofxVoronoiCell {
   public:
     vector<ofPoint> pts;
     ofPoint pt;
+    vector<int> neighbors;
+    
+    // Computed along with the cell. Points without a cell have zero
+    // area and their own position as the centroid
+    float area = 0;
+    float perimeter = 0;
+    ofPoint centroid;
+    float radius = 0;
+};
+
+// Counts of the work done by the last generate().
+// Apart from cellsComputed these stay zero unless Voro++2D is compiled
+// with VOROPP_COUNTERS=1.
+class ofxVoronoiStats {
+  public:
+    bool countersEnabled;
+    int cellsComputed;
+    uint64_t planeTests;
+    uint64_t planeCuts;
+    uint64_t worklistBlocks;
+    uint64_t searchBlocks;
+    uint64_t vertexGrowth;
+    uint64_t deleteStackGrowth;
+    uint64_t particleGrowth;
+    uint64_t deletedCells;
 };
 
 class ofxVoronoi {
@@ -15,11 +44,40 @@ private:
     vector<ofPoint> points;
     vector<ofxVoronoiCell> cells;
     
+    // Cell cache, indexed by point id. The container is kept between
+    // calls to generate() and only the cells it marks dirty are recomputed.
+    bool cacheEnabled;
+    unique_ptr<voro::container_2d> con;
+    ofRectangle cacheBounds;
+    vector<ofPoint> cachePoints;
+    vector<ofxVoronoiCell> cache;
+    
+    // Index in cells of each point id, or -1 if the point has no entry,
+    // and the point id that getCell() found last
+    vector<int> cellIndex;
+    int lastHit;
+    int lastRecomputed;
+    ofxVoronoiStats stats;
+    
+    void beginStats();
+    void endStats();
+    void syncContainer();
+    void syncPoint(int i);
+    void computeDirtyCells();
+    void computeCell(int ij, int q);
+    void collectCells(bool ordered);
+    int walkToCell(ofPoint _point);
+    
 public:
     ofxVoronoi();
     ~ofxVoronoi();
     
     void clear();
+    void clearCache();
+    // With ordered, getCells() holds one cell per point in point order,
+    // where a point outside the bounds gets a cell without vertices.
+    // Otherwise it only holds the points that have a cell, in the order
+    // of the container's blocks.
     void generate(bool ordered=true);
     void draw();
     
@@ -35,6 +93,11 @@ public:
     vector <ofxVoronoiCell>& getCells();
     ofxVoronoiCell& getCell(ofPoint _point, bool approximate=false);
     
+    void setCacheEnabled(bool _enabled);
+    bool isCacheEnabled();
+    int getLastRecomputedCount();
+    const ofxVoronoiStats& getStats();
+    
     //borg
     void relax();
 };
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "stageProfiler.h"
+
+#include <iomanip>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+//--------------------------------------------------------------
+// The value below which the given fraction of the sorted times lie, by
+// the nearest rank
+static float percentile(const vector<float>& sorted, float fraction)
+{
+	int rank = ceil(fraction * sorted.size());
+	return sorted[max(rank, 1) - 1];
+}
+
+//--------------------------------------------------------------
+stageProfiler::scopedTimer::scopedTimer(stageProfiler& _profiler, int _stage)
+	: profiler(_profiler)
+	, stage(_stage)
+	, start(ofGetElapsedTimeMicros())
+{
+}
+
+//--------------------------------------------------------------
+stageProfiler::scopedTimer::~scopedTimer()
+{
+	profiler.add(stage, (ofGetElapsedTimeMicros() - start) / 1000.0f);
+}
+
+//--------------------------------------------------------------
+stageProfiler::~stageProfiler()
+{
+	closeCsv();
+}
+
+//--------------------------------------------------------------
+int stageProfiler::addStage(const string& name)
+{
+	stages.push_back(stage());
+	stages.back().name = name;
+	stages.back().times.assign(frames.size(), -1);
+	return stages.size() - 1;
+}
+
+//--------------------------------------------------------------
+const string& stageProfiler::getStageName(int stage) const
+{
+	return stages[stage].name;
+}
+
+//--------------------------------------------------------------
+int stageProfiler::getStageCount() const
+{
+	return stages.size();
+}
+
+//--------------------------------------------------------------
+void stageProfiler::beginFrame()
+{
+	for (auto& stage : stages) {
+		stage.time = -1;
+	}
+}
+
+//--------------------------------------------------------------
+void stageProfiler::endFrame(uint64_t frame)
+{
+	for (auto& stage : stages) {
+		if (stage.time < 0) {
+			continue;
+		}
+		if (stage.recent.size() < WINDOW) {
+			stage.recent.push_back(stage.time);
+		}
+		else {
+			stage.recent[stage.recentNext] = stage.time;
+		}
+		stage.recentNext = (stage.recentNext + 1) % WINDOW;
+	}
+	if (keepFrames) {
+		frames.push_back(frame);
+		for (auto& stage : stages) {
+			stage.times.push_back(stage.time);
+		}
+	}
+	if (csv.is_open()) {
+		csv << frame;
+		for (auto& stage : stages) {
+			csv << ",";
+			if (stage.time >= 0) {
+				csv << stage.time;
+			}
+		}
+		csv << "\n";
+	}
+}
+
+//--------------------------------------------------------------
+void stageProfiler::begin(int stage)
+{
+	stages[stage].start = ofGetElapsedTimeMicros();
+}
+
+//--------------------------------------------------------------
+void stageProfiler::end(int stage)
+{
+	add(stage, (ofGetElapsedTimeMicros() - stages[stage].start) / 1000.0f);
+}
+
+//--------------------------------------------------------------
+void stageProfiler::add(int stage, float milliseconds)
+{
+	float& time = stages[stage].time;
+	time = max(time, 0.0f) + milliseconds;
+}
+
+//--------------------------------------------------------------
+void stageProfiler::setKeepFrames(bool keep)
+{
+	keepFrames = keep;
+}
+
+//--------------------------------------------------------------
+int stageProfiler::getFrameCount() const
+{
+	return frames.size();
+}
+
+//--------------------------------------------------------------
+void stageProfiler::writeSummary(ostream& out) const
+{
+	out << "stage,count,mean,p50,p95,p99,max,unit" << endl;
+	for (auto& stage : stages) {
+		vector<float> sorted;
+		double sum = 0;
+		for (float time : stage.times) {
+			if (time >= 0) {
+				sorted.push_back(time);
+				sum += time;
+			}
+		}
+		if (sorted.empty()) {
+			out << stage.name << ",0,,,,,,ms" << endl;
+			continue;
+		}
+		sort(sorted.begin(), sorted.end());
+		out << stage.name << "," << sorted.size() << "," << sum / sorted.size() << ","
+			<< percentile(sorted, 0.5f) << "," << percentile(sorted, 0.95f) << ","
+			<< percentile(sorted, 0.99f) << "," << sorted.back() << ",ms" << endl;
+	}
+	float peakMemory = getPeakMemory() / (1024.0f * 1024.0f);
+	out << "peak_memory,1," << peakMemory << "," << peakMemory << "," << peakMemory << ","
+		<< peakMemory << "," << peakMemory << ",MB" << endl;
+}
+
+//--------------------------------------------------------------
+bool stageProfiler::openCsv(const string& path)
+{
+	closeCsv();
+	csv.open(ofToDataPath(path, true).c_str());
+	if (!csv) {
+		ofLogError("stageProfiler") << "can't write " << path;
+		return false;
+	}
+	csv << "frame";
+	for (auto& stage : stages) {
+		csv << "," << stage.name;
+	}
+	csv << "\n";
+	return true;
+}
+
+//--------------------------------------------------------------
+void stageProfiler::closeCsv()
+{
+	if (csv.is_open()) {
+		csv.close();
+	}
+}
+
+//--------------------------------------------------------------
+bool stageProfiler::isCsvOpen() const
+{
+	return csv.is_open();
+}
+
+//--------------------------------------------------------------
+void stageProfiler::draw(float x, float y) const
+{
+	// Bucket i holds the times below 0.25 * 2^i milliseconds, the last
+	// one everything slower
+	const int BUCKETS = 9;
+	const float BAR_WIDTH = 6;
+	const float BAR_HEIGHT = 11;
+	const float LINE_HEIGHT = 14;
+
+	ofPushStyle();
+	stringstream header;
+	header << setw(12) << left << "stage" << setw(8) << right << "p50" << setw(8) << "p95" << setw(8) << "max";
+	ofDrawBitmapString(header.str(), x, y);
+	for (int i = 0; i < stages.size(); ++i) {
+		const stage& stage = stages[i];
+		float lineY = y + (i + 1) * LINE_HEIGHT;
+		stringstream line;
+		line << setw(12) << left << stage.name.substr(0, 11) << right << fixed << setprecision(2);
+		if (stage.recent.empty()) {
+			ofDrawBitmapString(line.str(), x, lineY);
+			continue;
+		}
+		vector<float> sorted = stage.recent;
+		sort(sorted.begin(), sorted.end());
+		line << setw(8) << percentile(sorted, 0.5f) << setw(8) << percentile(sorted, 0.95f) << setw(8) << sorted.back();
+		ofDrawBitmapString(line.str(), x, lineY);
+
+		int counts[BUCKETS] = {};
+		for (float time : sorted) {
+			int bucket = 0;
+			while (bucket < BUCKETS - 1 && time >= 0.25f * (1 << bucket)) {
+				++bucket;
+			}
+			++counts[bucket];
+		}
+		for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+			float height = BAR_HEIGHT * counts[bucket] / sorted.size();
+			ofDrawRectangle(x + 300 + bucket * BAR_WIDTH, lineY - height, BAR_WIDTH - 1, height);
+		}
+	}
+	ofPopStyle();
+}
+
+//--------------------------------------------------------------
+size_t stageProfiler::getPeakMemory()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return 0;
+	}
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#if defined(__APPLE__)
+	return usage.ru_maxrss;
+#else
+	// Linux reports kilobytes
+	return usage.ru_maxrss * size_t(1024);
+#endif
+#endif
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include <fstream>
+
+// Measures how long the stages of each frame take. The times of a stage
+// are added up between beginFrame() and endFrame(). The times of the
+// last WINDOW frames are kept for draw(), which shows a histogram of each
+// stage. With setKeepFrames(true) every frame's times are kept for
+// writeSummary(), and with openCsv() they are streamed to a file. A stage
+// that did not run in a frame is left out of its statistics.
+class stageProfiler {
+public:
+	// Times a stage from its construction to the end of its scope
+	class scopedTimer {
+	public:
+		scopedTimer(stageProfiler& profiler, int stage);
+		~scopedTimer();
+
+	private:
+		stageProfiler& profiler;
+		int stage;
+		uint64_t start;
+	};
+
+	~stageProfiler();
+
+	// Adds a stage, returning its id for the other calls
+	int addStage(const string& name);
+	const string& getStageName(int stage) const;
+	int getStageCount() const;
+
+	void beginFrame();
+	void endFrame(uint64_t frame);
+	void begin(int stage);
+	void end(int stage);
+	// Adds a time that was measured elsewhere, like on another thread
+	void add(int stage, float milliseconds);
+
+	void setKeepFrames(bool keep);
+	int getFrameCount() const;
+
+	// Writes the count, mean, median, 95th and 99th percentile and
+	// maximum of each stage's times in the kept frames as CSV, followed by
+	// the peak memory
+	void writeSummary(ostream& out) const;
+
+	// Writes the frame number and the time of each stage in each frame
+	// from now on as CSV, leaving out stages that did not run
+	bool openCsv(const string& path);
+	void closeCsv();
+	bool isCsvOpen() const;
+
+	// Draws the median, 95th percentile and maximum of each stage over the
+	// recent frames, with a histogram of the times in doubling buckets
+	void draw(float x, float y) const;
+
+	// Peak resident memory of the process in bytes
+	static size_t getPeakMemory();
+
+	static const int WINDOW = 240;
+
+private:
+	struct stage {
+		string name;
+		uint64_t start = 0;
+		// Time in the current frame in milliseconds, negative if the stage
+		// has not run
+		float time = -1;
+		// Time in each kept frame, negative where the stage did not run
+		vector<float> times;
+		// Ring of the times in the last frames that the stage ran in
+		vector<float> recent;
+		int recentNext = 0;
+	};
+
+	vector<stage> stages;
+	vector<uint64_t> frames;
+	bool keepFrames = false;
+	ofstream csv;
+};
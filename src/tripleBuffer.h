@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+
+// Hands values of T from one writer thread to one reader thread without
+// locks. The writer fills the back buffer and publishes it, the reader
+// picks up the most recently published buffer. Neither ever waits for the
+// other, and a buffer is never written while the reader holds it, so the
+// reader can use its buffer for as long as it likes. Values that are
+// published while the reader is busy are skipped. The buffers are reused,
+// so a T whose members keep their capacity causes no allocations once it
+// has reached its working size.
+template<class T>
+class tripleBuffer {
+public:
+	tripleBuffer() : back(0), middle(1), front(2) {}
+
+	// The buffer for the writer to fill. It still holds an older value,
+	// which the writer can reuse or overwrite.
+	T& getBackBuffer() {
+		return buffers[back];
+	}
+
+	// Makes the back buffer available to the reader, taking the previous
+	// middle buffer as the new back buffer
+	void publish() {
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Swaps the front buffer for the most recently published one, if there
+	// is one that the reader has not seen. Returns whether it did.
+	bool update() {
+		if(!(middle.load(std::memory_order_relaxed) & FRESH)) {
+			return false;
+		}
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+	// The buffer that the reader holds
+	const T& getFrontBuffer() const {
+		return buffers[front];
+	}
+
+private:
+	static const int INDEX = 3;
+	static const int FRESH = 4;
+
+	T buffers[3];
+	int back;
+	// Index of the middle buffer, with FRESH set if it was published
+	// after the reader last took it
+	std::atomic<int> middle;
+	int front;
+};